@@ -7,7 +7,7 @@
 
 // Map entry structure
 typedef struct {
-    const char* filename;  // Source file name
+    const char* filename;  // Source file name (owned by the entry)
     int line;             // Line number
     uint16_t address;     // Memory address
 } map_entry_t;
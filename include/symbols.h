@@ -28,14 +28,51 @@ typedef struct {
     uint16_t address;       // Memory address
     symbol_type_t type;     // Symbol type
     uint8_t desc;           // Symbol description
-    bool owns_strings;      // Whether this entry owns its strings
+    bool owns_strings;      // Whether this entry owns its strings (entries in a
+                            // table never do: the table's string pool does)
 } symbol_entry_t;
 
+struct symbol_index;
+struct symbol_strpool;
+struct symbol_files;
+struct symbol_arena;
+struct symbol_cache_file;
+
 // Structure for the symbol table
 typedef struct {
     symbol_entry_t* entries;    // Array of symbol entries
     size_t count;              // Number of entries
     size_t capacity;           // Current capacity
+
+    // Internal: interned filenames and names.  Entries point into the pool,
+    // so equal strings within a table share one pointer.  The string bytes
+    // live in the arena and are released all at once by symbols_free().
+    struct symbol_strpool* strings;
+    struct symbol_arena* arena;
+
+    // Internal: registry of the distinct filenames used by entries, with
+    // dense file ids and a basename hash (see symbols_get_source_files())
+    struct symbol_files* files;
+
+    // Internal: open-addressing index over (address, type) used by
+    // symbols_add_entry() to merge duplicates.  Slots hold entry index + 1.
+    uint32_t* merge_slots;      // Hash slots (0 = empty)
+    size_t merge_slot_count;    // Number of slots (power of two)
+    size_t merge_used;          // Number of occupied slots
+    bool merge_valid;           // False after entries were reordered
+
+    // Internal: derived lookup indices, built on demand by the lookup
+    // functions and dropped whenever entries change
+    struct symbol_index* index;
+    bool line_index_enabled;    // See symbols_set_line_index()
+    bool frozen;                // See symbols_freeze()
+
+    // Internal: changes whenever the entries do, for the lookup caches
+    size_t generation;
+
+    // Internal: the cache file a table from symbols_open_cache() uses in
+    // place (NULL for other tables)
+    struct symbol_cache_file* cache;
 } symbol_table_t;
 
 // Memory segment information
@@ -53,22 +90,85 @@ typedef struct {
     uint16_t entry_point;        // Program entry point address
 } binary_info_t;
 
+// Memory usage of the arena allocators behind a table or debug info
+typedef struct {
+    size_t blocks;          // Number of blocks obtained from malloc
+    size_t bytes_used;      // Bytes handed out by the arenas
+    size_t bytes_reserved;  // Bytes held by the arenas (used + free space)
+} symbol_arena_stats_t;
+
+// Memory used by a table or debug info, from the library's own bookkeeping
+// of every array and arena it holds (in bytes; fields that do not apply
+// are 0).  total_bytes is the sum of the byte fields other than the
+// duplicate and mapped ones.
+typedef struct {
+    size_t entry_bytes;          // Entries (debug info: functions) in use
+    size_t entry_slack_bytes;    // Allocated but unused entry capacity
+    size_t variable_bytes;       // Debug info variable arrays in use
+    size_t variable_slack_bytes; // Unused variable capacity, including the
+                                 // arrays left behind when one grew
+    size_t string_count;         // Strings stored
+    size_t string_bytes;         // Their characters, including the NULs
+    size_t duplicate_strings;    // Strings equal to one stored before
+    size_t duplicate_bytes;      // Their bytes: saved by the table's string
+                                 // pool, stored again by debug info
+    size_t index_bytes;          // Hash tables and lookup indices
+    size_t overhead_bytes;       // Headers, bookkeeping arrays, alignment
+                                 // and free arena space
+    size_t total_bytes;
+    size_t mapped_bytes;         // Cache file mapped by symbols_open_cache()
+                                 // or symbols_debug_info_open(); the strings
+                                 // and indices used in place there are
+                                 // counted here only
+} symbol_memory_stats_t;
+
 // Create a new symbol table
 symbol_table_t* symbols_create(void);
 
 // Free a symbol table and its contents
 void symbols_free(symbol_table_t* table);
 
+// Get arena memory usage (string storage and lookup indices)
+void symbols_get_arena_stats(const symbol_table_t* table, symbol_arena_stats_t* stats);
+
+// Get the memory used by a table, by kind
+void symbols_get_memory_stats(const symbol_table_t* table, symbol_memory_stats_t* stats);
+
 // Add a new entry to the symbol table
 bool symbols_add_entry(symbol_table_t* table, const char* filename, const char* name,
                       int line, uint16_t address, symbol_type_t type);
 
-// Look up a symbol by address
+// Add a batch of entries, then sort and merge duplicates in one pass
+bool symbols_add_entries_bulk(symbol_table_t* table, const symbol_entry_t* entries, size_t count);
+
+// Look up a symbol by address (first entry at that address in canonical order)
 const symbol_entry_t* symbols_lookup_by_address(const symbol_table_t* table, uint16_t address);
 
-// Look up a symbol by name
+// Type masks for symbols_lookup_floor()
+#define SYMBOL_TYPE_MASK(type) (1u << (type))
+#define SYMBOL_TYPE_MASK_ALL 0xffffffffu
+
+// Callback for symbols_lookup_range(); return false to stop the walk
+typedef bool (*symbol_range_callback_t)(const symbol_entry_t* entry, void* user_data);
+
+// Find the entry with the highest address <= 'address' whose type is in
+// 'type_mask'.  Among several at that address, the last one in canonical
+// order is returned (for LINE entries, the highest line).
+const symbol_entry_t* symbols_lookup_floor(const symbol_table_t* table, uint16_t address, unsigned type_mask);
+
+// Call 'callback' for each entry with lo <= address <= hi, in canonical
+// order.  Returns the number of entries visited.
+size_t symbols_lookup_range(const symbol_table_t* table, uint16_t lo, uint16_t hi,
+                            symbol_range_callback_t callback, void* user_data);
+
+// Look up a symbol by name (first entry with that name in table order)
 const symbol_entry_t* symbols_lookup_by_name(const symbol_table_t* table, const char* name);
 
+// Get the next entry with the same name as 'entry', for iterating over
+// duplicate names (e.g. static functions in different files):
+//   for (e = symbols_lookup_by_name(t, n); e; e = symbols_lookup_next_by_name(t, e))
+const symbol_entry_t* symbols_lookup_next_by_name(const symbol_table_t* table, const symbol_entry_t* entry);
+
 // Load symbols from an a.out file
 bool symbols_load_aout(symbol_table_t* table, const char* filename);
 
@@ -112,22 +212,65 @@ typedef struct {
     symbol_function_t *functions;
     int function_count;
     int function_capacity;
+    struct symbol_arena *arena;    /* Internal: names, type strings and variable arrays */
+    size_t generation;             /* Internal: changes on every load, for the lookup cache */
+    symbol_function_t **by_name;   /* Internal: functions sorted by name, for completion */
+    int by_name_count;
+    size_t by_name_generation;     /* Internal: generation 'by_name' was built for */
+    symbol_function_t **by_start;  /* Internal: functions sorted by start address, for lookups */
+    uint16_t *by_start_reach;      /* Internal: highest end address of each prefix of 'by_start' */
+    int by_start_count;
+    size_t by_start_generation;    /* Internal: generation 'by_start' was built for */
+    struct symbol_cache_file *cache;   /* Internal: file opened by symbols_debug_info_open() */
+    symbol_variable_t *cache_variables; /* Internal: variable arrays rebuilt from it (in the arena) */
+    int cache_variable_count;
 } symbol_debug_info_t;
 
 // Create/free debug info
 symbol_debug_info_t *symbols_debug_info_create(void);
 void symbols_debug_info_free(symbol_debug_info_t *info);
 
+// Get arena memory usage of debug info
+void symbols_debug_info_get_arena_stats(const symbol_debug_info_t *info,
+                                        symbol_arena_stats_t *stats);
+
+// Get the memory used by debug info, by kind.  Counting the duplicate
+// strings sorts a copy of the string pointers; the duplicate fields stay 0
+// if that copy cannot be allocated.
+void symbols_debug_info_get_memory_stats(const symbol_debug_info_t *info,
+                                         symbol_memory_stats_t *stats);
+
 // Load extended srcmap (FUNC/PARAM/LOCAL/LBRAC/RBRAC entries)
 bool symbols_load_srcmap_debug(symbol_debug_info_t *info,
                                const char *filename);
 
+// Write debug info to a binary file for symbols_debug_info_open():
+// functions sorted by start address, one flat variable array and every
+// distinct name and type string once.  The file is written under a
+// temporary name and renamed into place.
+bool symbols_debug_info_save(const symbol_debug_info_t *info, const char *path);
+
+// Open a file written by symbols_debug_info_save().  The file is mapped
+// read-only and the function, variable and type names point into it, so
+// they must not be modified; opening allocates the function array and one
+// variable array, without parsing anything.  Returns NULL if the file is
+// missing, was written by a different version or on a host with a
+// different byte order, or is malformed.  More srcmap files may be loaded
+// into the result; the mapping is released by symbols_debug_info_free().
+symbol_debug_info_t *symbols_debug_info_open(const char *path);
+
 // Lookup functions
 symbol_function_t *symbols_find_function_at(symbol_debug_info_t *info,
                                             uint16_t address);
 symbol_variable_t *symbols_get_variables(symbol_function_t *func,
                                          int *count);
 
+// Name completion: fill up to 'max' functions whose name starts with
+// 'prefix', in strcmp order of their names, and return how many were
+// filled.  The sorted name array is built on first use after a load.
+size_t symbols_complete_function(symbol_debug_info_t *info, const char *prefix,
+                                 symbol_function_t **functions, size_t max);
+
 // DAP-specific functions
 
 // Find address for a source location
@@ -136,9 +279,40 @@ bool symbols_find_address(const symbol_table_t *table, const char *filename, uin
 // Get source file for an address
 const char* symbols_get_file(const symbol_table_t* table, uint16_t address);
 
+// List the source files referenced by the table (DAP loadedSources), in
+// the order they were first loaded.  Fills up to 'max' paths and returns
+// the total number of files, so it can be called with max = 0 to size the
+// array.  The paths are owned by the table.
+size_t symbols_get_source_files(const symbol_table_t* table, const char** paths, size_t max);
+
 // Get line number for an address
 int symbols_get_line(const symbol_table_t* table, uint16_t address);
 
+// Source location of an address, as returned by symbols_get_file() and
+// symbols_get_line() (NULL and 0 outside mapped source)
+typedef struct {
+    const char* filename;
+    int line;
+} symbol_location_t;
+
+// Resolve 'count' addresses at once into out[0..count).  Large batches
+// resolve every address of the 16-bit space in one pass over the line
+// entries and then look the inputs up in that map, so the cost per address
+// is a single load.  Returns false on invalid arguments or out of memory.
+bool symbols_resolve_batch(const symbol_table_t* table, const uint16_t* addrs, size_t count,
+                           symbol_location_t* out);
+
+// Same, splitting very large batches across up to 'threads' threads
+// (ignored where POSIX threads are unavailable)
+bool symbols_resolve_batch_threaded(const symbol_table_t* table, const uint16_t* addrs, size_t count,
+                                    symbol_location_t* out, unsigned threads);
+
+// Enable or disable the 64K-slot address -> line index (256 KiB per table).
+// When enabled, symbols_get_file()/symbols_get_line() and stepping resolve
+// an address with a single array load.  The index is rebuilt after every
+// sort; returns false if it could not be built.
+bool symbols_set_line_index(symbol_table_t* table, bool enabled);
+
 // Check if an entry represents a line number
 bool symbols_is_line_entry(const symbol_entry_t* entry);
 
@@ -148,9 +322,227 @@ uint16_t symbols_get_next_line_address(const symbol_table_t* table, uint16_t cur
 // Comparison function for sorting entries by address
 int compare_entries_by_address(const void* a, const void* b);
 
-// Sort the symbol table by address (required for bsearch lookups)
+// Sort the symbol table into canonical order (required for lookups):
+// by address, then type, then line, otherwise keeping insertion order
 void symbols_sort_by_address(symbol_table_t* table);
 
+// Finish the load phase: build every lookup index, shrink the entry array
+// to fit and make the table read-only.  Afterwards adding, loading and
+// sorting fail (or do nothing), and no query builds anything lazily, so a
+// frozen table can be shared by concurrent readers.  Returns false if the
+// indices could not be built; the table is then left unfrozen.
+bool symbols_freeze(symbol_table_t* table);
+
+// Check whether symbols_freeze() was called on the table
+bool symbols_is_frozen(const symbol_table_t* table);
+
+// Precompiled symbol cache.  symbols_save_cache() writes a frozen table's
+// sorted entries, string pool and lookup indices to 'path' as one
+// versioned file of fixed-width integers and offsets (so it does not
+// depend on where it is loaded), and fails for a table that is not frozen.
+// The file is written under a temporary name and renamed into place, so
+// readers never see a partial file.
+bool symbols_save_cache(const symbol_table_t* table, const char* path);
+
+// Open a file written by symbols_save_cache() as a frozen table.  The file
+// is mapped read-only and its strings and indices are used in place;
+// opening allocates the entry array and a few bookkeeping arrays, without
+// parsing anything.  Returns NULL if the file is missing, was written by a
+// different version or on a host with a different byte order, fails its
+// checksums or is otherwise malformed.  The mapping is released by
+// symbols_free().
+symbol_table_t* symbols_open_cache(const char* path);
+
+// Flags for symbols_load_cached()
+#define SYMBOL_CACHE_HASH_CONTENTS 0x01u // Also key on a hash of the file contents
+
+// Load symbol files into an empty table through a cache directory.  The
+// cache file is named after a hash of every path with its size and
+// modification time (and contents, with SYMBOL_CACHE_HASH_CONTENTS), the
+// table's line index setting and the cache format.  If that file opens
+// with symbols_open_cache(), its contents are moved into 'table';
+// otherwise (missing or damaged) each path is loaded by extension (.s:
+// symbols_load_stabs(), .out: symbols_load_aout(), .map and .srcmap:
+// symbols_load_map()) and the result saved over it for the next run.
+// 'cache_dir' must exist; failing to write to it does not fail the load.
+// Returns true with the table frozen, or false if a path could not be
+// stat'ed or loaded, with the table left empty and unfrozen.
+bool symbols_load_cached(symbol_table_t* table, const char* const* paths, size_t count,
+                         const char* cache_dir, unsigned flags);
+
+// Shared handle to a frozen table, for one or more reader threads and a
+// thread that reloads symbols.  Readers never lock: they bracket their
+// queries with symbols_handle_read_begin()/_end(), and a reload builds a
+// new table on the side and swaps it in with symbols_handle_publish(),
+// which frees the old table once the readers that could see it are done.
+typedef struct symbols_handle symbols_handle_t;
+
+// A reader's hold on the published table (one per reading thread)
+typedef struct {
+    symbols_handle_t* handle;
+    const symbol_table_t* table;
+    unsigned slot;
+} symbols_reader_t;
+
+// Create a handle publishing 'table' (may be NULL).  The table is frozen
+// and owned by the handle from now on (unless creation fails).
+symbols_handle_t* symbols_handle_create(symbol_table_t* table);
+
+// Free the handle and its table; no reader may be active
+void symbols_handle_free(symbols_handle_t* handle);
+
+// Start reading: returns the current table (NULL if none), valid until
+// symbols_handle_read_end().  Keep reads short; a publish waits for them.
+const symbol_table_t* symbols_handle_read_begin(symbols_handle_t* handle, symbols_reader_t* reader);
+void symbols_handle_read_end(symbols_reader_t* reader);
+
+// Freeze 'table' (may be NULL), make it the current table, wait for the
+// readers of the previous one and free it.  Must not be called by a thread
+// that is inside a read.  Returns false if the table could not be frozen.
+bool symbols_handle_publish(symbols_handle_t* handle, symbol_table_t* table);
+
+// Hit and miss counts of the calling thread's lookup caches.  Each thread
+// remembers the address range of its last source line lookup (used by
+// symbols_get_file(), symbols_get_line() and stepping) and of its last
+// symbols_find_function_at() result, and answers repeated lookups in the
+// same range without searching.  Source lookups bypass the cache when the
+// line index is enabled, which is already a single load.
+typedef struct {
+    size_t source_hits;
+    size_t source_misses;
+    size_t function_hits;
+    size_t function_misses;
+} symbol_cache_stats_t;
+
+void symbols_get_cache_stats(symbol_cache_stats_t* stats);
+void symbols_reset_cache_stats(void);
+
+// Name completion: fill up to 'max' distinct entry names that start with
+// 'prefix' (an empty prefix matches all), in strcmp order, and return how
+// many were filled.  Runs a binary search over the sorted names, built on
+// first use, then copies the matches.
+size_t symbols_complete_name(const symbol_table_t* table, const char* prefix,
+                             const char** names, size_t max);
+
+// Flags for symbols_search()
+#define SYMBOL_SEARCH_IGNORE_CASE 0x01u // Compare without regard to case
+#define SYMBOL_SEARCH_REGEX 0x02u       // Pattern is a POSIX extended regex
+
+// How a name matched in symbols_search(), best first
+typedef enum {
+    SYMBOL_MATCH_EXACT,     // The whole name
+    SYMBOL_MATCH_PREFIX,    // The start of the name
+    SYMBOL_MATCH_SUBSTRING  // Anywhere else
+} symbol_match_t;
+
+// Called per matching name with the first entry (in table order) of that
+// name; return false to stop
+typedef bool (*symbol_search_callback_t)(const symbol_entry_t* entry, symbol_match_t match, void* user_data);
+
+// Search entry names for a substring (or a regex with SYMBOL_SEARCH_REGEX,
+// where available).  Each distinct name is reported once: exact matches
+// first, then prefix, then substring matches, each group in strcmp order.
+// Large tables are scanned on several threads.  Returns the number of
+// names passed to the callback.
+size_t symbols_search(const symbol_table_t* table, const char* pattern, unsigned flags,
+                      symbol_search_callback_t callback, void* user_data);
+
+// Load profiling.  While a profile is attached to a thread, the loaders
+// running on that thread (symbols_load_stabs(), _aout(), _map(),
+// symbols_load_srcmap_debug(), symbols_add_entries_bulk() and
+// symbols_sort_by_address()) record the wall time of each phase and what
+// it processed.  With no profile attached they only test a thread-local
+// pointer.  A profile must only be attached to one thread at a time.
+typedef enum {
+    SYMBOL_LOAD_PHASE_PARSE,   // Reading and parsing an input file
+    SYMBOL_LOAD_PHASE_INTERN,  // Interning the strings of a batch
+    SYMBOL_LOAD_PHASE_SORT,    // Sorting into canonical order
+    SYMBOL_LOAD_PHASE_MERGE,   // Merging duplicates, registering files
+    SYMBOL_LOAD_PHASE_INDEX,   // Rebuilding the address search indices
+                               // (debug info: the function ranges)
+    SYMBOL_LOAD_PHASE_COUNT
+} symbol_load_phase_t;
+
+typedef struct {
+    uint64_t load_ns;                            // Time spent in load functions
+    uint64_t phase_ns[SYMBOL_LOAD_PHASE_COUNT];  // Time per phase
+    size_t phase_runs[SYMBOL_LOAD_PHASE_COUNT];
+    size_t files_loaded;
+    size_t bytes_read;       // Input bytes read
+    size_t lines_parsed;     // Text lines read (a.out: symbols read)
+    size_t entries_added;    // Entries handed to tables
+    size_t entries_merged;   // Of those, merged into an existing entry
+    size_t allocations;      // Heap blocks obtained by the parsers, the
+                             // scratch arrays of a load and the arenas
+} symbol_load_stats_t;
+
+typedef struct symbol_load_profile symbol_load_profile_t;
+
+symbol_load_profile_t* symbols_load_profile_create(void);
+void symbols_load_profile_free(symbol_load_profile_t* profile);
+
+// Attach 'profile' to the calling thread (NULL detaches); returns the
+// profile that was attached before
+symbol_load_profile_t* symbols_load_profile_attach(symbol_load_profile_t* profile);
+
+// Totals recorded so far
+void symbols_load_profile_get_stats(const symbol_load_profile_t* profile, symbol_load_stats_t* stats);
+
+// Write every recorded load and phase as Chrome trace events (JSON, for
+// chrome://tracing or Perfetto).  Returns false if the file could not be
+// written.
+bool symbols_load_profile_write_trace(const symbol_load_profile_t* profile, const char* path);
+
+// Query statistics, compiled in with SYMBOLS_QUERY_STATS defined (CMake
+// option SYMBOLS_QUERY_STATS, or make QUERY_STATS=1).  Every public query
+// then counts its calls and their latency in a log2 histogram, in counters
+// of the calling thread that no other thread writes.  Queries made inside
+// another query (symbols_search() looking names up, say) are not counted.
+typedef enum {
+    SYMBOL_QUERY_LOOKUP_BY_ADDRESS,
+    SYMBOL_QUERY_LOOKUP_FLOOR,
+    SYMBOL_QUERY_LOOKUP_RANGE,
+    SYMBOL_QUERY_LOOKUP_BY_NAME,
+    SYMBOL_QUERY_LOOKUP_NEXT_BY_NAME,
+    SYMBOL_QUERY_FIND_ADDRESS,
+    SYMBOL_QUERY_GET_FILE,
+    SYMBOL_QUERY_GET_LINE,
+    SYMBOL_QUERY_GET_NEXT_LINE_ADDRESS,
+    SYMBOL_QUERY_GET_SOURCE_FILES,
+    SYMBOL_QUERY_RESOLVE_BATCH,
+    SYMBOL_QUERY_FIND_FUNCTION_AT,
+    SYMBOL_QUERY_GET_VARIABLES,
+    SYMBOL_QUERY_COMPLETE_NAME,
+    SYMBOL_QUERY_COMPLETE_FUNCTION,
+    SYMBOL_QUERY_SEARCH,
+    SYMBOL_QUERY_COUNT
+} symbol_query_t;
+
+// Bucket 0 counts calls under 1 ns, bucket b calls of 2^(b-1) to 2^b - 1
+// ns; the last bucket also counts everything slower
+#define SYMBOL_QUERY_HISTOGRAM_BUCKETS 32
+
+typedef struct {
+    uint64_t calls;
+    uint64_t total_ns;
+    uint64_t histogram[SYMBOL_QUERY_HISTOGRAM_BUCKETS];
+} symbol_query_counter_t;
+
+typedef struct {
+    symbol_query_counter_t queries[SYMBOL_QUERY_COUNT];
+} symbol_query_stats_t;
+
+// Sum the counters of every thread that made a query.  Returns false (and
+// zeros) when the library was built without SYMBOLS_QUERY_STATS.
+bool symbols_get_query_stats(symbol_query_stats_t* stats);
+
+// Zero every thread's counters.  Queries running meanwhile may keep counts
+// from before the reset.
+void symbols_reset_query_stats(void);
+
+// Function name of a query, for reports ("symbols_get_line")
+const char* symbols_query_name(symbol_query_t query);
+
 // Dump all symbols to stdout for debugging
 void symbols_dump_all(const symbol_table_t* table);
 
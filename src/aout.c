@@ -5,6 +5,7 @@
 
 #include "symbols.h"
 #include "aout.h"
+#include "symbols_profile.h"
 
 // Reference doc 2.11 BSD: https://www.retro11.de/ouxr/211bsd/usr/man/cat5/a.out.0.html
 
@@ -678,12 +679,14 @@ bool aout_parse_file(const char *filename, aout_entry_t **entries, size_t *count
     }
     
     aout_nlist_t nlist_sym;
+    size_t symbols_read = 0, bytes = sizeof(aout_header_t);
 
     for (int i = 0; i < num_symbols; i++)
     {            
         // Read the symbol entry
         if (fread(&nlist_sym, sizeof(nlist_sym), 1, f) != 1)
             break;
+        symbols_read++;
 
         // Save current position
         long cur_pos = ftell(f);
@@ -695,6 +698,7 @@ bool aout_parse_file(const char *filename, aout_entry_t **entries, size_t *count
         if (bytes_read > 0) {
             name[bytes_read] = '\0';  // Ensure null termination
         }
+        bytes += sizeof(nlist_sym) + bytes_read;
 
         // Initialize the entry directly in the array
         (*entries)[i].name = strdup(name);
@@ -717,6 +721,10 @@ bool aout_parse_file(const char *filename, aout_entry_t **entries, size_t *count
         fseek(f, cur_pos, SEEK_SET);
     }
 
+    // The entries array and one name copy per symbol
+    SYMBOLS_PROFILE_ADD(lines_parsed, symbols_read);
+    SYMBOLS_PROFILE_ADD(bytes_read, bytes);
+    SYMBOLS_PROFILE_ADD(allocations, 1 + symbols_read);
     fclose(f);
     return true;
 }
@@ -1,4 +1,6 @@
 #include "mapfile.h"
+#include "mapfile_internal.h"
+#include "symbols_profile.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -19,7 +21,18 @@ static char* trim_whitespace(char* str) {
     return str;
 }
 
-bool mapfile_parse_file(const char* filename, map_entry_t** entries, size_t* count) {
+static void free_entries(map_entry_t* entries, size_t count, bool shared) {
+    if (!entries) return;
+
+    // Shared runs of entries hold one filename copy; free each run once
+    for (size_t i = 0; i < count; i++) {
+        if (!shared || i == 0 || entries[i].filename != entries[i - 1].filename)
+            free((void*)entries[i].filename);
+    }
+    free(entries);
+}
+
+static bool parse_file(const char* filename, map_entry_t** entries, size_t* count, bool shared) {
     if (!filename || !entries || !count) return false;
 
     FILE* file = fopen(filename, "r");
@@ -38,8 +51,11 @@ bool mapfile_parse_file(const char* filename, map_entry_t** entries, size_t* cou
 
     *count = 0;
     char line[256];
+    size_t lines = 0, allocations = 1;
 
     while (fgets(line, sizeof(line), file)) {
+        lines++;
+
         // Skip empty lines and comments
         char* trimmed = trim_whitespace(line);
         if (*trimmed == '\0' || *trimmed == '#') continue;
@@ -82,21 +98,25 @@ bool mapfile_parse_file(const char* filename, map_entry_t** entries, size_t* cou
             capacity *= 2;
             map_entry_t* new_entries = realloc(*entries, capacity * sizeof(map_entry_t));
             if (!new_entries) {
-                mapfile_free_entries(*entries, *count);
+                free_entries(*entries, *count, shared);
                 fclose(file);
                 return false;
             }
             *entries = new_entries;
+            allocations++;
         }
 
-        // Add entry
+        // Add entry.  Consecutive lines almost always name the same file,
+        // so shared entries reuse the previous entry's copy of the filename.
         map_entry_t* entry = &(*entries)[*count];
-        entry->filename = strdup(filename);
+        const char* prev = shared && *count > 0 ? (*entries)[*count - 1].filename : NULL;
+        entry->filename = (prev && strcmp(prev, filename) == 0) ? prev : strdup(filename);
+        allocations += entry->filename != prev;
         entry->line = line_num;
         entry->address = address;
 
         if (!entry->filename) {
-            mapfile_free_entries(*entries, *count);
+            free_entries(*entries, *count, shared);
             fclose(file);
             return false;
         }
@@ -104,15 +124,25 @@ bool mapfile_parse_file(const char* filename, map_entry_t** entries, size_t* cou
         (*count)++;
     }
 
+    SYMBOLS_PROFILE_ADD(lines_parsed, lines);
+    SYMBOLS_PROFILE_ADD(bytes_read, (size_t)ftell(file));
+    SYMBOLS_PROFILE_ADD(allocations, allocations);
     fclose(file);
     return true;
 }
 
+bool mapfile_parse_file(const char* filename, map_entry_t** entries, size_t* count) {
+    return parse_file(filename, entries, count, false);
+}
+
 void mapfile_free_entries(map_entry_t* entries, size_t count) {
-    if (!entries) return;
+    free_entries(entries, count, false);
+}
 
-    for (size_t i = 0; i < count; i++) {
-        free((void*)entries[i].filename);
-    }
-    free(entries);
+bool mapfile_parse_file_shared(const char* filename, map_entry_t** entries, size_t* count) {
+    return parse_file(filename, entries, count, true);
+}
+
+void mapfile_free_shared_entries(map_entry_t* entries, size_t count) {
+    free_entries(entries, count, true);
 } 
\ No newline at end of file
@@ -0,0 +1,14 @@
+#ifndef MAPFILE_INTERNAL_H
+#define MAPFILE_INTERNAL_H
+
+#include "mapfile.h"
+
+// Internal: the map file parser as symbols_load_map() uses it.  Unlike
+// mapfile_parse_file(), consecutive entries with the same filename share
+// one copy of it, so a run of lines from one source file costs a single
+// allocation.  The array must be released as parsed (not reordered or
+// filtered) with mapfile_free_shared_entries().
+bool mapfile_parse_file_shared(const char* filename, map_entry_t** entries, size_t* count);
+void mapfile_free_shared_entries(map_entry_t* entries, size_t count);
+
+#endif /* MAPFILE_INTERNAL_H */
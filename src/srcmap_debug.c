@@ -6,6 +6,11 @@
  */
 
 #include "symbols.h"
+#include "symbols_arena.h"
+#include "symbols_cache.h"
+#include "symbols_cache_file.h"
+#include "symbols_profile.h"
+#include "symbols_query_stats.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,28 +20,150 @@ symbol_debug_info_t *
 symbols_debug_info_create(void)
 {
     symbol_debug_info_t *info = calloc(1, sizeof(*info));
+    if (!info)
+        return NULL;
+
+    info->arena = symbols_arena_create();
+    if (!info->arena) {
+        free(info);
+        return NULL;
+    }
+    info->generation = symbols_cache_next_generation();
     return info;
 }
 
 void
 symbols_debug_info_free(symbol_debug_info_t *info)
 {
-    int i, j;
+    if (!info)
+        return;
+
+    /* Names, type strings and variable arrays all live in the arena,
+     * or in the file the info was opened from */
+    symbols_arena_free(info->arena);
+    symbols_cache_file_close(info->cache);
+    free(info->functions);
+    free(info->by_name);
+    free(info->by_start);
+    free(info->by_start_reach);
+    free(info);
+}
+
+void
+symbols_debug_info_get_arena_stats(const symbol_debug_info_t *info,
+                                   symbol_arena_stats_t *stats)
+{
+    if (!stats)
+        return;
+
+    memset(stats, 0, sizeof(*stats));
+    if (info)
+        symbols_arena_add_stats(info->arena, stats);
+}
+
+static int
+compare_strings(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+/* Whether 'p' points into the file the info was opened from */
+static bool
+in_cache_file(const symbol_debug_info_t *info, const void *p)
+{
+    const unsigned char *c = p;
+
+    return info->cache && c >= info->cache->data &&
+           c < info->cache->data + info->cache->size;
+}
 
+/*
+ * Every string and variable array lives in the arena, so what the arena
+ * holds beyond them is alignment and free space.  Variable arrays start
+ * at 8 and double, leaving copies of 8 + 16 + ... + capacity / 2 =
+ * capacity - 8 variables behind; the arrays of opened info are slices of
+ * one exact-size array instead.  Strings in an opened file are counted
+ * in mapped_bytes, and are stored once each, so they are no duplicates.
+ */
+void
+symbols_debug_info_get_memory_stats(const symbol_debug_info_t *info,
+                                    symbol_memory_stats_t *stats)
+{
+    const char **strings;
+    size_t n = 0, i;
+    int f, v;
+
+    if (!stats)
+        return;
+
+    memset(stats, 0, sizeof(*stats));
     if (!info)
         return;
 
-    for (i = 0; i < info->function_count; i++) {
-        symbol_function_t *fn = &info->functions[i];
-        free(fn->name);
-        for (j = 0; j < fn->variable_count; j++) {
-            free(fn->variables[j].name);
-            free(fn->variables[j].type_name);
+    stats->entry_bytes = info->function_count * sizeof(symbol_function_t);
+    stats->entry_slack_bytes = (info->function_capacity - info->function_count) *
+                               sizeof(symbol_function_t);
+    for (f = 0; f < info->function_count; f++) {
+        const symbol_function_t *fn = &info->functions[f];
+
+        stats->variable_bytes += fn->variable_count * sizeof(symbol_variable_t);
+        stats->variable_slack_bytes += (fn->variable_capacity - fn->variable_count) *
+                                       sizeof(symbol_variable_t);
+        if (fn->variable_capacity > 8 &&
+            !(fn->variables >= info->cache_variables &&
+              fn->variables < info->cache_variables + info->cache_variable_count))
+            stats->variable_slack_bytes += (fn->variable_capacity - 8) * sizeof(symbol_variable_t);
+
+        stats->string_count += 1 + 2 * (size_t)fn->variable_count;
+        if (!in_cache_file(info, fn->name))
+            stats->string_bytes += strlen(fn->name) + 1;
+        for (v = 0; v < fn->variable_count; v++) {
+            if (!in_cache_file(info, fn->variables[v].name))
+                stats->string_bytes += strlen(fn->variables[v].name) + 1;
+            if (!in_cache_file(info, fn->variables[v].type_name))
+                stats->string_bytes += strlen(fn->variables[v].type_name) + 1;
         }
-        free(fn->variables);
     }
-    free(info->functions);
-    free(info);
+    if (info->cache)
+        stats->mapped_bytes = info->cache->size;
+
+    if (info->by_name)
+        stats->index_bytes = (info->by_name_count ? info->by_name_count : 1) * sizeof(*info->by_name);
+    if (info->by_start)
+        stats->index_bytes += (info->by_start_count ? info->by_start_count : 1) *
+                              (sizeof(*info->by_start) + sizeof(*info->by_start_reach));
+
+    stats->total_bytes = sizeof(*info) + info->function_capacity * sizeof(symbol_function_t) +
+                         stats->index_bytes + symbols_arena_footprint(info->arena) +
+                         (info->cache ? sizeof(*info->cache) : 0);
+    stats->overhead_bytes = stats->total_bytes - stats->entry_bytes - stats->entry_slack_bytes -
+                            stats->variable_bytes - stats->variable_slack_bytes -
+                            stats->string_bytes - stats->index_bytes;
+
+    /* Duplicates: sort the strings and count the repeats */
+    strings = malloc((stats->string_count ? stats->string_count : 1) * sizeof(*strings));
+    if (!strings)
+        return;
+    for (f = 0; f < info->function_count; f++) {
+        const symbol_function_t *fn = &info->functions[f];
+
+        if (!in_cache_file(info, fn->name))
+            strings[n++] = fn->name;
+        for (v = 0; v < fn->variable_count; v++) {
+            if (!in_cache_file(info, fn->variables[v].name))
+                strings[n++] = fn->variables[v].name;
+            if (!in_cache_file(info, fn->variables[v].type_name))
+                strings[n++] = fn->variables[v].type_name;
+        }
+    }
+    qsort(strings, n, sizeof(*strings), compare_strings);
+    for (i = 1; i < n; i++) {
+        if (strcmp(strings[i - 1], strings[i]) == 0) {
+            stats->duplicate_strings++;
+            stats->duplicate_bytes += strlen(strings[i]) + 1;
+        }
+    }
+    free(strings);
 }
 
 /*
@@ -61,11 +188,16 @@ find_or_add_function(symbol_debug_info_t *info, const char *name)
             return NULL;
         info->functions = nf;
         info->function_capacity = newcap;
+        SYMBOLS_PROFILE_ADD(allocations, 1);
     }
 
+    char *copy = symbols_arena_strdup(info->arena, name);
+    if (!copy)
+        return NULL;
+
     symbol_function_t *fn = &info->functions[info->function_count++];
     memset(fn, 0, sizeof(*fn));
-    fn->name = strdup(name);
+    fn->name = copy;
     fn->end_address = 0xFFFF; /* sentinel until RBRAC sets it */
     return fn;
 }
@@ -74,22 +206,33 @@ find_or_add_function(symbol_debug_info_t *info, const char *name)
  * Add a variable (param or local) to a function.
  */
 static bool
-add_variable(symbol_function_t *fn, const char *name,
-             const char *type_name, int offset, bool is_parameter)
+add_variable(symbol_debug_info_t *info, symbol_function_t *fn,
+             const char *name, const char *type_name, int offset,
+             bool is_parameter)
 {
+    /* Arrays grow by copying within the arena; the old copy is dropped
+     * with the arena, which costs at most the size of the final array. */
     if (fn->variable_count >= fn->variable_capacity) {
         int newcap = fn->variable_capacity ? fn->variable_capacity * 2 : 8;
-        symbol_variable_t *nv = realloc(fn->variables,
-                                        newcap * sizeof(*nv));
+        symbol_variable_t *nv = symbols_arena_alloc(info->arena,
+                                                    newcap * sizeof(*nv),
+                                                    sizeof(void *));
         if (!nv)
             return false;
+        if (fn->variable_count > 0)
+            memcpy(nv, fn->variables, fn->variable_count * sizeof(*nv));
         fn->variables = nv;
         fn->variable_capacity = newcap;
     }
 
+    char *name_copy = symbols_arena_strdup(info->arena, name);
+    char *type_copy = symbols_arena_strdup(info->arena, type_name);
+    if (!name_copy || !type_copy)
+        return false;
+
     symbol_variable_t *v = &fn->variables[fn->variable_count++];
-    v->name = strdup(name);
-    v->type_name = strdup(type_name);
+    v->name = name_copy;
+    v->type_name = type_copy;
     v->offset = offset;
     v->is_parameter = is_parameter;
     return true;
@@ -108,21 +251,75 @@ trim(char *s)
     return s;
 }
 
+static int
+compare_function_starts(const void *a, const void *b)
+{
+    const symbol_function_t *fa = *(const symbol_function_t *const *)a;
+    const symbol_function_t *fb = *(const symbol_function_t *const *)b;
+
+    if (fa->start_address != fb->start_address)
+        return fa->start_address < fb->start_address ? -1 : 1;
+    /* Keep functions at the same address in their original order */
+    return fa < fb ? -1 : fa > fb;
+}
+
+/*
+ * Sort the functions by start address for find_function_at(), with the
+ * highest end address of each prefix: walking back from the last function
+ * that starts at or below an address can stop where that falls below it.
+ * Called after every load, so lookups only read; on failure they scan.
+ */
+static void
+build_by_start(symbol_debug_info_t *info)
+{
+    size_t n = info->function_count ? (size_t)info->function_count : 1;
+    symbol_function_t **by_start = realloc(info->by_start, n * sizeof(*by_start));
+    uint16_t *reach;
+    int i;
+
+    if (by_start)
+        info->by_start = by_start;
+    reach = realloc(info->by_start_reach, n * sizeof(*reach));
+    if (reach)
+        info->by_start_reach = reach;
+    if (!by_start || !reach) {
+        info->by_start_generation = 0;
+        return;
+    }
+
+    for (i = 0; i < info->function_count; i++)
+        by_start[i] = &info->functions[i];
+    qsort(by_start, (size_t)info->function_count, sizeof(*by_start), compare_function_starts);
+    for (i = 0; i < info->function_count; i++) {
+        uint16_t end = by_start[i]->end_address;
+        reach[i] = i > 0 && reach[i - 1] > end ? reach[i - 1] : end;
+    }
+    info->by_start_count = info->function_count;
+    info->by_start_generation = info->generation;
+}
+
 bool
 symbols_load_srcmap_debug(symbol_debug_info_t *info, const char *filename)
 {
     FILE *f;
     char line[512];
+    uint64_t start, load_start;
+    size_t lines = 0;
 
     if (!info || !filename)
         return false;
 
+    if (!info->arena && !(info->arena = symbols_arena_create()))
+        return false;
+
+    load_start = symbols_profile_start();
     f = fopen(filename, "r");
     if (!f)
         return false;
 
     while (fgets(line, sizeof(line), f)) {
         char *p = trim(line);
+        lines++;
 
         /* Skip comments and empty lines */
         if (*p == '#' || *p == '\0')
@@ -171,7 +368,7 @@ symbols_load_srcmap_debug(symbol_debug_info_t *info, const char *filename)
 
             symbol_function_t *fn = find_or_add_function(info, funcname);
             if (fn)
-                add_variable(fn, varname, typename_str, offset, true);
+                add_variable(info, fn, varname, typename_str, offset, true);
             continue;
         }
 
@@ -199,7 +396,7 @@ symbols_load_srcmap_debug(symbol_debug_info_t *info, const char *filename)
 
             symbol_function_t *fn = find_or_add_function(info, funcname);
             if (fn)
-                add_variable(fn, varname, typename_str, offset, false);
+                add_variable(info, fn, varname, typename_str, offset, false);
             continue;
         }
 
@@ -233,7 +430,11 @@ symbols_load_srcmap_debug(symbol_debug_info_t *info, const char *filename)
          * they are handled by the existing mapfile_parse_file() */
     }
 
+    SYMBOLS_PROFILE_ADD(lines_parsed, lines);
+    SYMBOLS_PROFILE_ADD(bytes_read, (size_t)ftell(f));
     fclose(f);
+    symbols_profile_end(SYMBOL_LOAD_PHASE_PARSE, load_start, lines);
+    start = symbols_profile_start();
 
     /* Fix up end_address: use the next function's start_address - 1
      * instead of RBRAC, because the return code (after RBRAC) is still
@@ -252,40 +453,408 @@ symbols_load_srcmap_debug(symbol_debug_info_t *info, const char *filename)
         /* else keep the existing end_address (RBRAC or 0xFFFF sentinel) */
     }
 
+    /* Functions were added and moved: drop cached lookups */
+    info->generation = symbols_cache_next_generation();
+    build_by_start(info);
+
+    symbols_profile_end(SYMBOL_LOAD_PHASE_INDEX, start, info->function_count);
+    symbols_profile_end_load(filename, load_start, info->function_count);
+
     return info->function_count > 0;
 }
 
-symbol_function_t *
-symbols_find_function_at(symbol_debug_info_t *info, uint16_t address)
+/*
+ * Binary debug info file: a header, then three sections, each padded to a
+ * multiple of 8 bytes:
+ *   functions  one struct debug_file_function each, by start address
+ *   variables  one struct debug_file_variable each; the variables of a
+ *              function are contiguous, in function order
+ *   strings    every distinct name and type string once, NUL terminated
+ * The section offsets follow from the counts.  Bump DEBUG_FILE_VERSION
+ * whenever the layout changes; files of other versions are rejected.
+ */
+#define DEBUG_FILE_MAGIC "SYMDEBUG"
+#define DEBUG_FILE_VERSION 1u
+#define DEBUG_FILE_BYTE_ORDER 0x01020304u
+
+struct debug_file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;       /* DEBUG_FILE_BYTE_ORDER as written */
+    uint64_t file_size;
+    uint32_t function_count;
+    uint32_t variable_count;
+    uint64_t string_bytes;
+};
+
+struct debug_file_function {
+    uint32_t name;             /* Offset in the strings section */
+    uint16_t start_address;
+    uint16_t end_address;
+    uint32_t first_variable;
+    uint32_t variable_count;
+};
+
+struct debug_file_variable {
+    uint32_t name;
+    uint32_t type_name;
+    int32_t offset;
+    uint32_t is_parameter;
+};
+
+static uint64_t
+debug_file_size(uint64_t function_count, uint64_t variable_count, uint64_t string_bytes)
+{
+    return ((sizeof(struct debug_file_header) + 7) & ~(uint64_t)7) +
+           ((function_count * sizeof(struct debug_file_function) + 7) & ~(uint64_t)7) +
+           ((variable_count * sizeof(struct debug_file_variable) + 7) & ~(uint64_t)7) +
+           ((string_bytes + 7) & ~(uint64_t)7);
+}
+
+/*
+ * Strings being written, each stored once: an open addressing hash set of
+ * offsets (plus one, so 0 is empty) into the text.
+ */
+struct string_set {
+    char *text;
+    size_t size;
+    uint32_t *slots;
+    size_t mask;
+};
+
+static uint32_t
+intern_string(struct string_set *set, const char *s)
+{
+    size_t length = strlen(s) + 1, i;
+    uint32_t hash = 2166136261u;
+    const unsigned char *p;
+
+    for (p = (const unsigned char *)s; *p; p++)
+        hash = (hash ^ *p) * 16777619u;
+
+    for (i = hash & set->mask; set->slots[i]; i = (i + 1) & set->mask) {
+        if (strcmp(set->text + set->slots[i] - 1, s) == 0)
+            return set->slots[i] - 1;
+    }
+    memcpy(set->text + set->size, s, length);
+    set->slots[i] = (uint32_t)set->size + 1;
+    set->size += length;
+    return set->slots[i] - 1;
+}
+
+bool
+symbols_debug_info_save(const symbol_debug_info_t *info, const char *path)
+{
+    struct debug_file_header header;
+    struct debug_file_function *functions;
+    struct debug_file_variable *variables;
+    const symbol_function_t **order;
+    struct string_set set;
+    size_t variable_count = 0, text_size = 0, slot_count = 16, n;
+    char *temp = NULL;
+    FILE *out;
+    bool ok;
+    int f, v;
+
+    if (!info || !path)
+        return false;
+
+    /* Room for every string without interning, and a set at most half full */
+    for (f = 0; f < info->function_count; f++) {
+        const symbol_function_t *fn = &info->functions[f];
+
+        variable_count += (size_t)fn->variable_count;
+        text_size += strlen(fn->name) + 1;
+        for (v = 0; v < fn->variable_count; v++)
+            text_size += strlen(fn->variables[v].name) + 1 +
+                         strlen(fn->variables[v].type_name) + 1;
+    }
+    if (variable_count > UINT32_MAX || text_size >= UINT32_MAX)
+        return false;
+    while (slot_count < 2 * ((size_t)info->function_count + 2 * variable_count))
+        slot_count *= 2;
+
+    order = malloc((info->function_count ? info->function_count : 1) * sizeof(*order));
+    functions = malloc((info->function_count ? info->function_count : 1) * sizeof(*functions));
+    variables = malloc((variable_count ? variable_count : 1) * sizeof(*variables));
+    set.text = malloc(text_size ? text_size : 1);
+    set.slots = calloc(slot_count, sizeof(*set.slots));
+    set.size = 0;
+    set.mask = slot_count - 1;
+    ok = order && functions && variables && set.text && set.slots;
+
+    if (ok) {
+        for (f = 0; f < info->function_count; f++)
+            order[f] = &info->functions[f];
+        qsort(order, (size_t)info->function_count, sizeof(*order), compare_function_starts);
+
+        n = 0;
+        for (f = 0; f < info->function_count; f++) {
+            const symbol_function_t *fn = order[f];
+            struct debug_file_function *record = &functions[f];
+
+            record->name = intern_string(&set, fn->name);
+            record->start_address = fn->start_address;
+            record->end_address = fn->end_address;
+            record->first_variable = (uint32_t)n;
+            record->variable_count = (uint32_t)fn->variable_count;
+            for (v = 0; v < fn->variable_count; v++, n++) {
+                variables[n].name = intern_string(&set, fn->variables[v].name);
+                variables[n].type_name = intern_string(&set, fn->variables[v].type_name);
+                variables[n].offset = fn->variables[v].offset;
+                variables[n].is_parameter = fn->variables[v].is_parameter;
+            }
+        }
+
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, DEBUG_FILE_MAGIC, sizeof(header.magic));
+        header.version = DEBUG_FILE_VERSION;
+        header.byte_order = DEBUG_FILE_BYTE_ORDER;
+        header.function_count = (uint32_t)info->function_count;
+        header.variable_count = (uint32_t)variable_count;
+        header.string_bytes = set.size;
+        header.file_size = debug_file_size(header.function_count, header.variable_count,
+                                           header.string_bytes);
+    }
+
+    out = ok ? symbols_cache_file_create(path, &temp) : NULL;
+    if (out) {
+        ok = symbols_cache_file_write(out, &header, sizeof(header)) &&
+             symbols_cache_file_write(out, functions, info->function_count * sizeof(*functions)) &&
+             symbols_cache_file_write(out, variables, variable_count * sizeof(*variables)) &&
+             symbols_cache_file_write(out, set.text, set.size);
+        ok = symbols_cache_file_commit(out, temp, path, ok);
+    } else {
+        ok = false;
+    }
+
+    free(order);
+    free(functions);
+    free(variables);
+    free(set.text);
+    free(set.slots);
+    return ok;
+}
+
+/* The header, if the file is debug info this build can use */
+static const struct debug_file_header *
+check_debug_file(const struct symbol_cache_file *file)
+{
+    const struct debug_file_header *header;
+    const char *strings;
+
+    if (file->size < sizeof(*header))
+        return NULL;
+
+    /* Page or malloc aligned, like every 8-byte aligned section after it */
+    header = (const struct debug_file_header *)file->data;
+    if (memcmp(header->magic, DEBUG_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != DEBUG_FILE_VERSION || header->byte_order != DEBUG_FILE_BYTE_ORDER ||
+        header->file_size != file->size || header->function_count > INT32_MAX ||
+        header->variable_count > INT32_MAX || header->string_bytes >= UINT32_MAX ||
+        header->file_size != debug_file_size(header->function_count, header->variable_count,
+                                             header->string_bytes))
+        return NULL;
+
+    /* Every string offset below string_bytes then ends inside the file */
+    strings = (const char *)file->data + file->size -
+              ((header->string_bytes + 7) & ~(uint64_t)7);
+    if (header->string_bytes > 0 && strings[header->string_bytes - 1] != '\0')
+        return NULL;
+    return header;
+}
+
+/*
+ * Strings are used in place; the functions and one array holding every
+ * variable are rebuilt, checking each string offset and variable run.
+ */
+symbol_debug_info_t *
+symbols_debug_info_open(const char *path)
+{
+    const struct debug_file_header *header;
+    const struct debug_file_function *functions;
+    const struct debug_file_variable *variables;
+    struct symbol_cache_file *file;
+    symbol_debug_info_t *info;
+    const char *strings;
+    uint64_t load_start;
+    uint32_t f, v, next = 0;
+
+    if (!path)
+        return NULL;
+
+    load_start = symbols_profile_start();
+    file = symbols_cache_file_open(path);
+    if (!file)
+        return NULL;
+
+    header = check_debug_file(file);
+    info = header ? symbols_debug_info_create() : NULL;
+    if (!info) {
+        symbols_cache_file_close(file);
+        return NULL;
+    }
+    info->cache = file;
+
+    functions = (const struct debug_file_function *)(file->data +
+                ((sizeof(*header) + 7) & ~(size_t)7));
+    variables = (const struct debug_file_variable *)((const unsigned char *)functions +
+                ((header->function_count * sizeof(*functions) + 7) & ~(size_t)7));
+    strings = (const char *)variables +
+              ((header->variable_count * sizeof(*variables) + 7) & ~(size_t)7);
+
+    info->functions = malloc((header->function_count ? header->function_count : 1) *
+                             sizeof(symbol_function_t));
+    info->cache_variables = header->variable_count ?
+        symbols_arena_alloc(info->arena, header->variable_count * sizeof(symbol_variable_t),
+                            sizeof(void *)) : NULL;
+    if (!info->functions || (header->variable_count && !info->cache_variables)) {
+        symbols_debug_info_free(info);
+        return NULL;
+    }
+    info->function_capacity = (int)header->function_count;
+    info->cache_variable_count = (int)header->variable_count;
+
+    for (v = 0; v < header->variable_count; v++) {
+        symbol_variable_t *var = &info->cache_variables[v];
+
+        if (variables[v].name >= header->string_bytes ||
+            variables[v].type_name >= header->string_bytes) {
+            symbols_debug_info_free(info);
+            return NULL;
+        }
+        var->name = (char *)strings + variables[v].name;
+        var->type_name = (char *)strings + variables[v].type_name;
+        var->offset = variables[v].offset;
+        var->is_parameter = variables[v].is_parameter != 0;
+    }
+
+    /* Each function takes the next run of variables */
+    for (f = 0; f < header->function_count; f++) {
+        symbol_function_t *fn = &info->functions[f];
+
+        if (functions[f].name >= header->string_bytes || functions[f].first_variable != next ||
+            functions[f].variable_count > header->variable_count - next) {
+            symbols_debug_info_free(info);
+            return NULL;
+        }
+        fn->name = (char *)strings + functions[f].name;
+        fn->start_address = functions[f].start_address;
+        fn->end_address = functions[f].end_address;
+        fn->variables = functions[f].variable_count ? &info->cache_variables[next] : NULL;
+        fn->variable_count = (int)functions[f].variable_count;
+        fn->variable_capacity = fn->variable_count;
+        next += functions[f].variable_count;
+        info->function_count++;
+    }
+    if (next != header->variable_count) {
+        symbols_debug_info_free(info);
+        return NULL;
+    }
+    build_by_start(info);
+
+    symbols_profile_end_load(path, load_start, (size_t)info->function_count);
+    return info;
+}
+
+/*
+ * The best function for an address so far, and the nearest addresses on
+ * both sides where the answer can change.
+ */
+struct function_match {
+    symbol_function_t *best;
+    uint16_t best_range;
+    uint32_t lo, hi;
+};
+
+static void
+match_function(struct function_match *m, symbol_function_t *fn, uint16_t address)
+{
+    uint32_t start = fn->start_address;
+    uint32_t after = (uint32_t)fn->end_address + 1;
+    uint16_t range;
+
+    /* The set of functions containing the address, and so the answer,
+     * only changes where some function starts or ends: track the
+     * nearest such boundaries on both sides */
+    if (start <= address) {
+        if (start > m->lo) m->lo = start;
+    } else if (start < m->hi) {
+        m->hi = start;
+    }
+    if (after <= address) {
+        if (after > m->lo) m->lo = after;
+    } else if (after < m->hi) {
+        m->hi = after;
+    }
+
+    if (address < fn->start_address || address > fn->end_address)
+        return;
+
+    range = fn->end_address - fn->start_address;
+    if (fn->end_address == 0xFFFF)
+        range = 0xFFFE;  /* Penalize sentinel, but still consider */
+
+    /* Among equal ranges the first function in the array wins */
+    if (!m->best || range < m->best_range ||
+        (range == m->best_range && fn < m->best)) {
+        m->best = fn;
+        m->best_range = range;
+    }
+}
+
+static symbol_function_t *
+find_function_at(symbol_debug_info_t *info, uint16_t address)
 {
     int i;
-    symbol_function_t *best = NULL;
-    uint16_t best_range = 0xFFFF;
+    struct function_match m = { NULL, 0xFFFF, 0, 0x10000 };
+    symbol_range_cache_t *cache = &symbols_thread_cache.function;
+    const void *cached;
 
     if (!info)
         return NULL;
 
-    for (i = 0; i < info->function_count; i++) {
-        symbol_function_t *fn = &info->functions[i];
-        uint16_t range;
-
-        if (address < fn->start_address || address > fn->end_address)
-            continue;
+    if (symbols_cache_lookup(cache, info, info->generation, address, &cached))
+        return (symbol_function_t *)cached;
 
-        range = fn->end_address - fn->start_address;
-        if (fn->end_address == 0xFFFF)
-            range = 0xFFFE;  /* Penalize sentinel, but still consider */
+    if (info->by_start && info->by_start_generation == info->generation) {
+        /* Binary search for the first function starting above the
+         * address; later functions cannot contain it */
+        size_t lo = 0, hi = (size_t)info->by_start_count;
 
-        if (!best || range < best_range) {
-            best = fn;
-            best_range = range;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (info->by_start[mid]->start_address <= address)
+                lo = mid + 1;
+            else
+                hi = mid;
         }
+        if (lo < (size_t)info->by_start_count)
+            m.hi = info->by_start[lo]->start_address;
+
+        /* Walk back while some earlier function still reaches the
+         * address: usually one step, more for nested functions */
+        for (; lo > 0 && info->by_start_reach[lo - 1] >= address; lo--)
+            match_function(&m, info->by_start[lo - 1], address);
+        if (lo > 0 && (uint32_t)info->by_start_reach[lo - 1] + 1 > m.lo)
+            m.lo = (uint32_t)info->by_start_reach[lo - 1] + 1;
+    } else {
+        for (i = 0; i < info->function_count; i++)
+            match_function(&m, &info->functions[i], address);
     }
-    return best;
+
+    symbols_cache_store(cache, info, info->generation, m.lo, m.hi, m.best);
+    return m.best;
 }
 
-symbol_variable_t *
-symbols_get_variables(symbol_function_t *func, int *count)
+symbol_function_t *
+symbols_find_function_at(symbol_debug_info_t *info, uint16_t address)
+{
+    SYMBOLS_QUERY(SYMBOL_QUERY_FIND_FUNCTION_AT, symbol_function_t *, find_function_at(info, address));
+}
+
+static symbol_variable_t *
+get_variables(symbol_function_t *func, int *count)
 {
     if (!func) {
         if (count) *count = 0;
@@ -295,3 +864,69 @@ symbols_get_variables(symbol_function_t *func, int *count)
         *count = func->variable_count;
     return func->variables;
 }
+
+symbol_variable_t *
+symbols_get_variables(symbol_function_t *func, int *count)
+{
+    SYMBOLS_QUERY(SYMBOL_QUERY_GET_VARIABLES, symbol_variable_t *, get_variables(func, count));
+}
+
+static int
+compare_function_names(const void *a, const void *b)
+{
+    const symbol_function_t *fa = *(symbol_function_t *const *)a;
+    const symbol_function_t *fb = *(symbol_function_t *const *)b;
+    return strcmp(fa->name, fb->name);
+}
+
+static size_t
+complete_function(symbol_debug_info_t *info, const char *prefix,
+                  symbol_function_t **functions, size_t max)
+{
+    size_t lo, hi, length, count = 0;
+    int i, n = 0;
+
+    if (!info || !prefix || (!functions && max > 0))
+        return 0;
+
+    /* (Re)build the sorted array after a load */
+    if (info->by_name_generation != info->generation || !info->by_name) {
+        symbol_function_t **by_name = realloc(info->by_name,
+            (info->function_count ? info->function_count : 1) * sizeof(*by_name));
+        if (!by_name)
+            return 0;
+        info->by_name = by_name;
+        for (i = 0; i < info->function_count; i++)
+            if (info->functions[i].name)
+                by_name[n++] = &info->functions[i];
+        qsort(by_name, (size_t)n, sizeof(*by_name), compare_function_names);
+        info->by_name_count = n;
+        info->by_name_generation = info->generation;
+    }
+
+    /* First name >= prefix; every name with the prefix follows it */
+    lo = 0;
+    hi = (size_t)info->by_name_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strcmp(info->by_name[mid]->name, prefix) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    length = strlen(prefix);
+    for (; lo < (size_t)info->by_name_count && count < max; lo++) {
+        if (strncmp(info->by_name[lo]->name, prefix, length) != 0)
+            break;
+        functions[count++] = info->by_name[lo];
+    }
+    return count;
+}
+
+size_t
+symbols_complete_function(symbol_debug_info_t *info, const char *prefix,
+                          symbol_function_t **functions, size_t max)
+{
+    SYMBOLS_QUERY(SYMBOL_QUERY_COMPLETE_FUNCTION, size_t, complete_function(info, prefix, functions, max));
+}
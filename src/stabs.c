@@ -1,4 +1,5 @@
 #include "stabs.h"
+#include "symbols_profile.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -104,11 +105,16 @@ bool stabs_parse_file(const char* filename, stab_entry_t** entries, size_t* coun
     *count = 0;
     char line[1024];
     const char* current_file = NULL;
+    size_t lines = 0, allocations = 1;
 
     while (fgets(line, sizeof(line), file)) {
         stab_entry_t entry = {0};
+        lines++;
         
         if (parse_stab_line(line, &entry)) {
+            // The stab string, name and type copies
+            allocations += 3;
+
             // Handle file name entries
             if (entry.type_code == N_SO) {
                 current_file = entry.name;
@@ -125,12 +131,16 @@ bool stabs_parse_file(const char* filename, stab_entry_t** entries, size_t* coun
                     return false;
                 }
                 *entries = new_entries;
+                allocations++;
             }
 
             (*entries)[(*count)++] = entry;
         }
     }
 
+    SYMBOLS_PROFILE_ADD(lines_parsed, lines);
+    SYMBOLS_PROFILE_ADD(bytes_read, (size_t)ftell(file));
+    SYMBOLS_PROFILE_ADD(allocations, allocations);
     fclose(file);
     return true;
 } 
\ No newline at end of file
@@ -1,13 +1,29 @@
 #include "symbols.h"
+#include "symbols_index.h"
+#include "symbols_strpool.h"
+#include "symbols_files.h"
+#include "symbols_search.h"
+#include "symbols_cache.h"
+#include "symbols_arena.h"
+#include "symbols_profile.h"
+#include "symbols_query_stats.h"
+#include "symbols_cache_file.h"
 #include "stabs.h"
 #include "aout.h"
-#include "mapfile.h"
+#include "mapfile_internal.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <limits.h>
 
+#if !defined(_WIN32)
+#include <pthread.h>
+#define SYMBOLS_HAVE_PTHREAD 1
+#else
+#define SYMBOLS_HAVE_PTHREAD 0
+#endif
+
 // Comparison function for qsort and bsearch
 int compare_entries_by_address(const void *a, const void *b)
 {
@@ -66,6 +82,29 @@ symbol_table_t *symbols_create(void)
         return NULL;
     }
 
+    table->arena = symbols_arena_create();
+    table->strings = symbols_strpool_create(table->arena);
+    table->files = symbols_files_create();
+    if (!table->strings || !table->files)
+    {
+        symbols_files_free(table->files);
+        symbols_strpool_free(table->strings);
+        symbols_arena_free(table->arena);
+        free(table->entries);
+        free(table);
+        return NULL;
+    }
+
+    table->merge_slots = NULL;
+    table->merge_slot_count = 0;
+    table->merge_used = 0;
+    table->merge_valid = false;
+    table->index = NULL;
+    table->line_index_enabled = false;
+    table->frozen = false;
+    table->generation = symbols_cache_next_generation();
+    table->cache = NULL;
+
     return table;
 }
 
@@ -75,43 +114,115 @@ void symbols_free(symbol_table_t *table)
     if (!table)
         return;
 
-    // Free all entries
-    for (size_t i = 0; i < table->count; i++)
+    // Entries own no memory of their own: strings live in the pool's
+    // arena, and the indices in their own arena (or, for a table opened
+    // from a cache file, both in the file)
+    symbols_index_free(table);
+    symbols_files_free(table->files);
+    symbols_strpool_free(table->strings);
+    symbols_arena_free(table->arena);
+    free(table->entries);
+    free(table->merge_slots);
+    symbols_cache_file_close(table->cache);
+    free(table);
+}
+
+// Get arena memory usage (string storage and lookup indices)
+void symbols_get_arena_stats(const symbol_table_t *table, symbol_arena_stats_t *stats)
+{
+    if (!stats)
+        return;
+
+    memset(stats, 0, sizeof(*stats));
+    if (!table)
+        return;
+
+    symbols_arena_add_stats(table->arena, stats);
+    if (table->index)
+        symbols_arena_add_stats(table->index->arena, stats);
+}
+
+/// @brief Reports the memory held by a table, by kind
+/// @param table Pointer to the symbol table
+/// @param stats Filled with the sizes of every array and arena of the table
+void symbols_get_memory_stats(const symbol_table_t *table, symbol_memory_stats_t *stats)
+{
+    if (!stats)
+        return;
+
+    memset(stats, 0, sizeof(*stats));
+    if (!table)
+        return;
+
+    const struct symbol_strpool *pool = table->strings;
+    const struct symbol_files *files = table->files;
+    size_t pool_slot_bytes = pool->slot_count * sizeof(*pool->slots);
+    size_t merge_bytes = table->merge_slot_count * sizeof(*table->merge_slots);
+    size_t file_bytes = files->capacity * (sizeof(*files->paths) + sizeof(*files->basenames) +
+                                           sizeof(*files->next_same_base)) +
+                        files->string_capacity * sizeof(*files->by_string) +
+                        files->base_slot_count * sizeof(*files->base_slots);
+
+    stats->entry_bytes = table->count * sizeof(symbol_entry_t);
+    stats->entry_slack_bytes = (table->capacity - table->count) * sizeof(symbol_entry_t);
+
+    // Each distinct string is stored once, so duplicates cost nothing.  A
+    // table opened from a cache file uses the strings in the file.
+    stats->string_count = pool->count;
+    stats->string_bytes = table->cache ? 0 : pool->string_bytes;
+    stats->duplicate_strings = pool->duplicates;
+    stats->duplicate_bytes = pool->duplicate_bytes;
+
+    stats->index_bytes = pool_slot_bytes + merge_bytes + file_bytes;
+    stats->total_bytes = sizeof(*table) + table->capacity * sizeof(symbol_entry_t) +
+                         sizeof(*pool) + pool->capacity * sizeof(*pool->strings) + pool_slot_bytes +
+                         symbols_arena_footprint(table->arena) +
+                         sizeof(*files) + file_bytes + merge_bytes;
+    if (table->index)
     {
-        symbol_entry_t *entry = &table->entries[i];
-        if (entry->owns_strings)
-        {
-            if (entry->name)
-                free((void *)entry->name);
-            if (entry->filename)
-                free((void *)entry->filename);
-        }
+        stats->index_bytes += table->index->arena->bytes_used;
+        stats->total_bytes += sizeof(*table->index) + symbols_arena_footprint(table->index->arena);
+    }
+    if (table->cache)
+    {
+        stats->mapped_bytes = table->cache->size;
+        stats->total_bytes += sizeof(*table->cache);
     }
 
-    // Free the entries array
-    free(table->entries);
-    free(table);
+    // The rest: struct headers, the pool's string array and id prefixes,
+    // alignment and unused arena space
+    stats->overhead_bytes = stats->total_bytes - stats->entry_bytes - stats->entry_slack_bytes -
+                            stats->string_bytes - stats->index_bytes;
 }
 
-/// @brief Adds a symbol to the symbol table that marks the beginning of a source file
+/// @brief Appends a symbol that marks the beginning of a source file to a load batch
 /// @param table Pointer to the symbol table
+/// @param batch Batch of entries that will be passed to symbols_add_entries_bulk()
+/// @param batch_count Number of entries in the batch, incremented if the symbol is added
 /// @param filename Name of the source file
 /// @param is_start True if this is the start of a source file, false if it is the end
 /// @return True if the symbol was added, false if it already exists
-bool add_file_start_symbol(symbol_table_t *table, const char *filename, bool is_start)
+static bool add_file_start_symbol(const symbol_table_t *table, symbol_entry_t *batch,
+                                  size_t *batch_count, const char *filename, bool is_start)
 {
     if (!table)
         return false;
 
-    // First check if we already have this symbol file registered
+    // First check if we already have this symbol file registered, either in
+    // the table or earlier in the same batch.  Every filename used by an
+    // entry is in the file registry; a string that was never interned
+    // cannot be one of them.
     if ((filename && is_start))
     {
-        for (size_t i = 0; i < table->count; i++)
+        const char *pooled = symbols_strpool_find(table->strings, filename);
+        if (pooled && symbols_files_id(table->files, pooled) != SYMBOL_FILE_NONE)
         {
-            symbol_entry_t *existing = &table->entries[i];
-
-            // compare strings
-            if (strcmp(existing->filename, filename) == 0)
+            return false;
+        }
+        for (size_t i = 0; i < *batch_count; i++)
+        {
+            if (batch[i].type == SYMBOL_TYPE_FILE && batch[i].filename &&
+                strcmp(batch[i].filename, filename) == 0)
             {
                 return false;
             }
@@ -127,56 +238,134 @@ bool add_file_start_symbol(symbol_table_t *table, const char *filename, bool is_
         .type = SYMBOL_TYPE_FILE,
         .owns_strings = false};
 
-    return symbols_add_entry(table, entry.filename, entry.name, entry.line, entry.address, entry.type);
+    batch[(*batch_count)++] = entry;
+    return true;
+}
+
+// LINE and FILE entries are never merged: multiple source lines can map to
+// the same address (e.g. blank line + statement), and multiple source files
+// all have address 0 but represent different files.
+static bool is_mergeable_type(symbol_type_t type)
+{
+    return type != SYMBOL_TYPE_LINE && type != SYMBOL_TYPE_FILE;
+}
+
+// Fibonacci hash of the (address, type) merge key
+static size_t merge_hash(uint16_t address, symbol_type_t type, size_t slot_count)
+{
+    uint32_t key = (uint32_t)address | ((uint32_t)type << 16);
+    return (size_t)((key * 2654435761u) >> 7) & (slot_count - 1);
+}
+
+// Find the slot holding (address, type), or the empty slot where it belongs.
+// Slots are verified against the entries themselves, so a stale slot can
+// only cause a missed merge, never a wrong one.
+static uint32_t *merge_find_slot(const symbol_table_t *table, uint16_t address, symbol_type_t type)
+{
+    size_t mask = table->merge_slot_count - 1;
+    size_t i = merge_hash(address, type, table->merge_slot_count);
+
+    for (;;)
+    {
+        uint32_t slot = table->merge_slots[i];
+        if (slot == 0)
+            return &table->merge_slots[i];
+
+        if (slot <= table->count)
+        {
+            const symbol_entry_t *existing = &table->entries[slot - 1];
+            if (existing->address == address && existing->type == type)
+                return &table->merge_slots[i];
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+// (Re)build the merge index with at least min_slots slots, keeping the
+// load factor at or below one half.
+static bool merge_index_rebuild(symbol_table_t *table, size_t min_slots)
+{
+    size_t slot_count = 64;
+    while (slot_count < min_slots || slot_count < table->count * 2)
+        slot_count *= 2;
+
+    uint32_t *slots = calloc(slot_count, sizeof(uint32_t));
+    if (!slots)
+        return false;
+
+    free(table->merge_slots);
+    table->merge_slots = slots;
+    table->merge_slot_count = slot_count;
+    table->merge_used = 0;
+
+    for (size_t i = 0; i < table->count; i++)
+    {
+        const symbol_entry_t *entry = &table->entries[i];
+        if (!is_mergeable_type(entry->type))
+            continue;
+
+        uint32_t *slot = merge_find_slot(table, entry->address, entry->type);
+        if (*slot == 0)
+        {
+            // Keep the first entry for a key, as the linear scan did
+            *slot = (uint32_t)i + 1;
+            table->merge_used++;
+        }
+    }
+
+    table->merge_valid = true;
+    return true;
 }
 
 // Add a new entry to the symbol table or update existing one
 bool symbols_add_entry(symbol_table_t *table, const char *filename, const char *name,
                        int line, uint16_t address, symbol_type_t type)
 {
-    if (!table)
+    if (!table || table->frozen)
         return false;
 
-    for (size_t i = 0; i < table->count; i++)
+    symbols_index_invalidate(table);
+    SYMBOLS_PROFILE_ADD(entries_added, 1);
+
+    bool mergeable = is_mergeable_type(type);
+
+    if (mergeable && (!table->merge_valid ||
+                      (table->merge_used + 1) * 2 > table->merge_slot_count))
     {
-        symbol_entry_t *existing = &table->entries[i];
-        // Don't merge LINE entries - multiple source lines can map to
-        // the same address (e.g. blank line + statement)
-        // Don't merge FILE entries - multiple source files all have
-        // address 0 but represent different files
-        if (type == SYMBOL_TYPE_LINE || type == SYMBOL_TYPE_FILE)
-            break;
-        if ((existing->address == address) && (existing->type == type))
+        if (!merge_index_rebuild(table, (table->merge_used + 1) * 4))
+            return false;
+    }
+
+    // Share one pooled copy of each distinct string
+    if (filename && !(filename = symbols_strpool_intern(table->strings, filename)))
+        return false;
+    if (name && !(name = symbols_strpool_intern(table->strings, name)))
+        return false;
+    if (filename && !symbols_files_reserve(table->files, table->strings->count))
+        return false;
+
+    uint32_t *merge_slot = mergeable ? merge_find_slot(table, address, type) : NULL;
+
+    if (merge_slot && *merge_slot != 0)
+    {
+        symbol_entry_t *existing = &table->entries[*merge_slot - 1];
+        // Found existing symbol, update missing information
+        if (filename && !existing->filename)
         {
-            // Found existing symbol, update missing information
-            if (filename && !existing->filename)
-            {
-                existing->filename = strdup(filename);
-                if (!existing->filename)
-                    return false;
-            }
-            if (name && !existing->name)
-            {
-                existing->name = strdup(name);
-                if (!existing->name)
-                {
-                    if (filename && !existing->filename)
-                    {
-                        free((void *)existing->filename);
-                    }
-                    return false;
-                }
-            }
-            if (line > 0 && existing->line == 0)
-            {
-                existing->line = line;
-            }
-            if (type != SYMBOL_TYPE_UNKNOWN && existing->type == SYMBOL_TYPE_UNKNOWN)
-            {
-                existing->type = type;
-            }
-            return true; // Successfully updated existing symbol
+            if (symbols_files_add(table->files, filename) == SYMBOL_FILE_NONE)
+                return false;
+            existing->filename = filename;
+        }
+        if (name && !existing->name)
+        {
+            existing->name = name;
+        }
+        if (line > 0 && existing->line == 0)
+        {
+            existing->line = line;
         }
+        SYMBOLS_PROFILE_ADD(entries_merged, 1);
+        return true; // Successfully updated existing symbol
     }
 
     // No existing symbol found, add new entry
@@ -191,49 +380,211 @@ bool symbols_add_entry(symbol_table_t *table, const char *filename, const char *
         table->capacity = new_capacity;
     }
 
+    if (filename && symbols_files_add(table->files, filename) == SYMBOL_FILE_NONE)
+        return false;
+
     // Initialize new entry
     symbol_entry_t *entry = &table->entries[table->count];
-    entry->owns_strings = true;
+    entry->owns_strings = false;
+    entry->filename = filename;
+    entry->name = name;
+    entry->line = line;
+    entry->address = address;
+    entry->type = type;
 
-    if (filename)
+    table->count++;
+
+    if (merge_slot)
     {
-        entry->filename = strdup(filename);
-        if (!entry->filename)
-            return false;
+        *merge_slot = (uint32_t)table->count;
+        table->merge_used++;
     }
-    else
+    return true;
+}
+
+// Build the optional indices that are prepared as soon as the table is
+// sorted, so that the first lookup after loading does not pay for them
+static void rebuild_sorted_indices(symbol_table_t *table)
+{
+    uint64_t start = symbols_profile_start();
+    symbols_index_get(table, SYMBOL_INDEX_PACKED | SYMBOL_INDEX_SEARCH);
+    if (table->line_index_enabled)
+        symbols_index_get(table, SYMBOL_INDEX_LINE_MAP | SYMBOL_INDEX_LINE_NEXT);
+    symbols_profile_end(SYMBOL_LOAD_PHASE_INDEX, start, table->count);
+}
+
+// Sort key for the canonical entry order: address, then type, then line,
+// then position in the table (so sorting is stable).  Mergeable types
+// leave the line out: their duplicates must sort in insertion order for
+// merging, and after merging there is one entry per (address, type).
+typedef struct
+{
+    uint64_t order;
+    uint32_t position;
+} sort_key_t;
+
+static sort_key_t make_sort_key(const symbol_entry_t *entry, size_t position)
+{
+    uint32_t line = is_mergeable_type(entry->type) ? 0 : (uint32_t)entry->line ^ 0x80000000u;
+    sort_key_t key = {
+        .order = ((uint64_t)entry->address << 48) |
+                 ((uint64_t)(entry->type & 0xff) << 32) |
+                 (uint64_t)line,
+        .position = (uint32_t)position};
+    return key;
+}
+
+static int compare_sort_keys(const void *a, const void *b)
+{
+    const sort_key_t *key_a = (const sort_key_t *)a;
+    const sort_key_t *key_b = (const sort_key_t *)b;
+    if (key_a->order != key_b->order)
+        return key_a->order < key_b->order ? -1 : 1;
+    return (key_a->position > key_b->position) - (key_a->position < key_b->position);
+}
+
+/// @brief Adds a batch of entries, then sorts and merges the whole table once
+/// @param table Pointer to the symbol table
+/// @param batch Entries to add; strings are interned, owns_strings is ignored
+/// @param count Number of entries in the batch
+/// @return True on success; on failure the table is left unchanged
+///
+/// Duplicates are merged with the same rules as symbols_add_entry(): entries
+/// with equal (address, type) collapse into the one added first, and missing
+/// name, filename and line are filled in from later ones in insertion order.
+/// LINE and FILE entries are never merged.  The table is left in canonical
+/// order (see symbols_sort_by_address()).
+bool symbols_add_entries_bulk(symbol_table_t *table, const symbol_entry_t *batch, size_t count)
+{
+    if (!table || table->frozen || (!batch && count > 0))
+        return false;
+
+    size_t total = table->count + count;
+    if (total > UINT32_MAX)
+        return false;
+    if (total == 0)
+        return true;
+
+    symbols_index_invalidate(table);
+    SYMBOLS_PROFILE_ADD(entries_added, count);
+
+    sort_key_t *keys = malloc(total * sizeof(sort_key_t));
+    symbol_entry_t *merged = malloc(total * sizeof(symbol_entry_t));
+    symbol_entry_t *incoming = count > 0 ? malloc(count * sizeof(symbol_entry_t)) : NULL;
+    if (!keys || !merged || (count > 0 && !incoming))
     {
-        entry->filename = NULL;
+        free(keys);
+        free(merged);
+        free(incoming);
+        return false;
     }
+    SYMBOLS_PROFILE_ADD(allocations, count > 0 ? 3 : 2);
 
-    if (name)
+    // Intern the batch strings first so that a failure leaves the table as
+    // it was (at worst with a few unused pool strings)
+    uint64_t start = symbols_profile_start();
+    for (size_t i = 0; i < count; i++)
     {
-        entry->name = strdup(name);
-        if (!entry->name)
+        incoming[i] = batch[i];
+        incoming[i].owns_strings = false;
+        incoming[i].filename = symbols_strpool_intern(table->strings, batch[i].filename);
+        incoming[i].name = symbols_strpool_intern(table->strings, batch[i].name);
+
+        if ((batch[i].filename && !incoming[i].filename) ||
+            (batch[i].name && !incoming[i].name))
         {
-            free((void *)entry->filename);
+            free(keys);
+            free(merged);
+            free(incoming);
             return false;
         }
     }
-    else
+    if (!symbols_files_reserve(table->files, table->strings->count))
     {
-        entry->name = NULL;
+        free(keys);
+        free(merged);
+        free(incoming);
+        return false;
     }
 
-    entry->line = line;
-    entry->address = address;
-    entry->type = type;
+    symbols_profile_end(SYMBOL_LOAD_PHASE_INTERN, start, count);
 
-    table->count++;
+    start = symbols_profile_start();
+    for (size_t i = 0; i < total; i++)
+    {
+        const symbol_entry_t *entry = i < table->count ? &table->entries[i] : &incoming[i - table->count];
+        keys[i] = make_sort_key(entry, i);
+    }
+    qsort(keys, total, sizeof(sort_key_t), compare_sort_keys);
+    symbols_profile_end(SYMBOL_LOAD_PHASE_SORT, start, total);
+
+    // Single pass in key order: copy entries and fold duplicates
+    start = symbols_profile_start();
+    size_t out = 0;
+    for (size_t k = 0; k < total; k++)
+    {
+        size_t position = keys[k].position;
+        symbol_entry_t entry = position < table->count ? table->entries[position]
+                                                        : incoming[position - table->count];
+
+        if (out > 0 && is_mergeable_type(entry.type))
+        {
+            symbol_entry_t *existing = &merged[out - 1];
+            if (existing->address == entry.address && existing->type == entry.type)
+            {
+                // Same rules as symbols_add_entry(): keys within a group are
+                // in insertion order, so the first value seen wins
+                if (entry.filename && !existing->filename)
+                    existing->filename = entry.filename;
+                if (entry.name && !existing->name)
+                    existing->name = entry.name;
+                if (entry.line > 0 && existing->line == 0)
+                    existing->line = entry.line;
+                continue;
+            }
+        }
+
+        merged[out++] = entry;
+    }
+
+    // Register the filenames that ended up in the table; if the registry
+    // cannot grow, the table is left as it was
+    size_t file_count = table->files->count;
+    for (size_t i = 0; i < out; i++)
+    {
+        if (merged[i].filename && symbols_files_add(table->files, merged[i].filename) == SYMBOL_FILE_NONE)
+        {
+            symbols_files_truncate(table->files, file_count);
+            free(keys);
+            free(merged);
+            free(incoming);
+            return false;
+        }
+    }
+    symbols_profile_end(SYMBOL_LOAD_PHASE_MERGE, start, total);
+    SYMBOLS_PROFILE_ADD(entries_merged, total - out);
+
+    free(keys);
+    free(incoming);
+    free(table->entries);
+
+    table->entries = merged;
+    table->count = out;
+    table->capacity = total;
+
+    // Entry positions changed; the merge index is rebuilt on the next add
+    table->merge_valid = false;
+    rebuild_sorted_indices(table);
     return true;
 }
 
 // Load symbols from a STABS .s file
 bool symbols_load_stabs(symbol_table_t *table, const char *filename)
 {
-    if (!table || !filename)
+    if (!table || table->frozen || !filename)
         return false;
 
+    uint64_t load_start = symbols_profile_start();
     stab_entry_t *entries = NULL;
     size_t count = 0;
 
@@ -241,11 +592,22 @@ bool symbols_load_stabs(symbol_table_t *table, const char *filename)
     {
         return false;
     }
+    symbols_profile_end(SYMBOL_LOAD_PHASE_PARSE, load_start, count);
+
+    // Room for the parsed entries plus the file start and end symbols
+    symbol_entry_t *batch = malloc((count + 2) * sizeof(symbol_entry_t));
+    if (!batch)
+    {
+        stabs_free_entries(entries, count);
+        return false;
+    }
+    SYMBOLS_PROFILE_ADD(allocations, 1);
+    size_t batch_count = 0;
 
     // Add a symbol to tell that source files begins here
-    bool start_symbol_added = add_file_start_symbol(table, entries[0].filename, true);
+    bool start_symbol_added = count > 0 &&
+                              add_file_start_symbol(table, batch, &batch_count, entries[0].filename, true);
 
-    bool success = true;
     for (size_t i = 0; i < count; i++)
     {
         symbol_entry_t entry = {
@@ -256,24 +618,20 @@ bool symbols_load_stabs(symbol_table_t *table, const char *filename)
             .type = map_stabs_type(entries[i].type_code),
             .owns_strings = false};
 
-        if (!symbols_add_entry(table, entry.filename, entry.name,
-                               entry.line, entry.address, entry.type))
-        {
-            success = false;
-            break;
-        }
+        batch[batch_count++] = entry;
     }
 
     if (start_symbol_added)
     {
         // add ending symbol
-        add_file_start_symbol(table, "", false);
+        add_file_start_symbol(table, batch, &batch_count, "", false);
     }
 
-    stabs_free_entries(entries, count);
+    bool success = symbols_add_entries_bulk(table, batch, batch_count);
 
-    if (success)
-        symbols_sort_by_address(table);
+    free(batch);
+    stabs_free_entries(entries, count);
+    symbols_profile_end_load(filename, load_start, batch_count);
 
     return success;
 }
@@ -281,9 +639,10 @@ bool symbols_load_stabs(symbol_table_t *table, const char *filename)
 // Load symbols from an a.out file
 bool symbols_load_aout(symbol_table_t *table, const char *filename)
 {
-    if (!table || !filename)
+    if (!table || table->frozen || !filename)
         return false;
 
+    uint64_t load_start = symbols_profile_start();
     aout_entry_t *entries = NULL;
     size_t count = 0;
 
@@ -291,10 +650,22 @@ bool symbols_load_aout(symbol_table_t *table, const char *filename)
     {
         return false;
     }
+    symbols_profile_end(SYMBOL_LOAD_PHASE_PARSE, load_start, count);
+
+    // Room for the parsed entries plus the file start and end symbols
+    symbol_entry_t *batch = malloc((count + 2) * sizeof(symbol_entry_t));
+    if (!batch)
+    {
+        aout_free_entries(entries, count);
+        return false;
+    }
+    SYMBOLS_PROFILE_ADD(allocations, 1);
+    size_t batch_count = 0;
 
     // Create filanme with .s ending instead of .out
     size_t fname_len = strlen(filename);
     char *filename_s = malloc(fname_len + 4);
+    SYMBOLS_PROFILE_ADD(allocations, filename_s != NULL);
 
     // replace .out with .smake all
     strncpy(filename_s, filename, strlen(filename) - 4);
@@ -302,10 +673,8 @@ bool symbols_load_aout(symbol_table_t *table, const char *filename)
     strcat(filename_s, ".s");
 
     // Add a symbol to tell that source files begins here
-    bool start_symbol_added = add_file_start_symbol(table, filename_s, true);
-    free(filename_s);
+    bool start_symbol_added = add_file_start_symbol(table, batch, &batch_count, filename_s, true);
 
-    bool success = true;
     for (int i = 0; i < (int)count; i++)
     {
 
@@ -318,46 +687,39 @@ bool symbols_load_aout(symbol_table_t *table, const char *filename)
             .type = map_nlist_type(entries[i].type),
             .owns_strings = false};
 
-        if (!symbols_add_entry(table, entry.filename, entry.name,
-                               entry.line, entry.address, entry.type))
+        batch[batch_count++] = entry;
+
+        char s_name[100];
+        if (entry.name)
         {
-            
-            success = false;
-            break;
+          strcpy(s_name, entry.name);
         }
         else
         {
-          char s_name[100];
-          if (entry.name)
-          {
-            strcpy(s_name, entry.name);
-          }
-          else
-          {
-            strcpy(s_name, "(null)");
-          }
-
+          strcpy(s_name, "(null)");
+        }
 
-            printf("[%d] Added symbol: %s at %06o, Type 0x%04x '%s'", i, s_name, entry.address, entries[i].type, get_symbol_type(entries[i].type));
-            if (entries[i].desc>0)
-            {
-                printf(", desc: %d (%s)", entries[i].desc, get_symbol_desc(entries[i].type));
-            }
-            printf("\n");
 
+        printf("[%d] Added symbol: %s at %06o, Type 0x%04x '%s'", i, s_name, entry.address, entries[i].type, get_symbol_type(entries[i].type));
+        if (entries[i].desc>0)
+        {
+            printf(", desc: %d (%s)", entries[i].desc, get_symbol_desc(entries[i].type));
         }
+        printf("\n");
     }
 
     if (start_symbol_added)
     {
         // add ending symbol
-        add_file_start_symbol(table, "", false);
+        add_file_start_symbol(table, batch, &batch_count, "", false);
     }
 
-    aout_free_entries(entries, count);
+    bool success = symbols_add_entries_bulk(table, batch, batch_count);
 
-    if (success)
-        symbols_sort_by_address(table);
+    free(filename_s);
+    free(batch);
+    aout_free_entries(entries, count);
+    symbols_profile_end_load(filename, load_start, batch_count);
 
     return success;
 }
@@ -365,16 +727,28 @@ bool symbols_load_aout(symbol_table_t *table, const char *filename)
 // Load symbols from a map file
 bool symbols_load_map(symbol_table_t *table, const char *filename)
 {
-    if (!table || !filename)
+    if (!table || table->frozen || !filename)
         return false;
 
+    uint64_t load_start = symbols_profile_start();
     map_entry_t *entries = NULL;
     size_t count = 0;
 
-    if (!mapfile_parse_file(filename, &entries, &count))
+    if (!mapfile_parse_file_shared(filename, &entries, &count))
+    {
+        return false;
+    }
+    symbols_profile_end(SYMBOL_LOAD_PHASE_PARSE, load_start, count);
+
+    // Room for one FILE entry per line entry in the worst case
+    symbol_entry_t *batch = malloc((2 * count + 1) * sizeof(symbol_entry_t));
+    if (!batch)
     {
+        mapfile_free_shared_entries(entries, count);
         return false;
     }
+    SYMBOLS_PROFILE_ADD(allocations, 1);
+    size_t batch_count = 0;
 
     /* Add FILE entries for every unique source file in the srcmap.
      * Without these, symbols_find_address() can't match filenames
@@ -386,13 +760,12 @@ bool symbols_load_map(symbol_table_t *table, const char *filename)
             if (entries[i].filename &&
                 (!last_file || strcmp(entries[i].filename, last_file) != 0))
             {
-                add_file_start_symbol(table, entries[i].filename, true);
+                add_file_start_symbol(table, batch, &batch_count, entries[i].filename, true);
                 last_file = entries[i].filename;
             }
         }
     }
 
-    bool success = true;
     for (size_t i = 0; i < count; i++)
     {
         symbol_entry_t entry = {
@@ -403,47 +776,207 @@ bool symbols_load_map(symbol_table_t *table, const char *filename)
             .type = SYMBOL_TYPE_LINE,
             .owns_strings = false};
 
-        if (!symbols_add_entry(table, entry.filename, entry.name,
-                               entry.line, entry.address, entry.type))
-        {
-            success = false;
-            break;
-        }
+        batch[batch_count++] = entry;
     }
 
-    mapfile_free_entries(entries, count);
+    bool success = symbols_add_entries_bulk(table, batch, batch_count);
 
-    if (success)
-        symbols_sort_by_address(table);
+    free(batch);
+    mapfile_free_shared_entries(entries, count);
+    symbols_profile_end_load(filename, load_start, batch_count);
 
     return success;
 }
 
-// Look up a symbol by address
+// First position whose address is >= 'address' (table->count if none)
+static size_t lower_bound(const symbol_table_t *table, uint16_t address)
+{
+    const struct symbol_index *index = symbols_index_get(table, SYMBOL_INDEX_SEARCH);
+    if (index)
+        return symbols_search_lower_bound(index, table->count, address);
+
+    // Out of memory for the search index: plain binary search on the entries
+    size_t lo = 0, hi = table->count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (table->entries[mid].address < address)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// First position whose address is > 'address' (table->count if none)
+static size_t upper_bound(const symbol_table_t *table, uint16_t address)
+{
+    const struct symbol_index *index = symbols_index_get(table, SYMBOL_INDEX_SEARCH);
+    if (index)
+        return symbols_search_lower_bound(index, table->count, (uint32_t)address + 1);
+
+    size_t lo = 0, hi = table->count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (table->entries[mid].address <= address)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Look up a symbol by address.  When several entries share the address,
+// the first one in canonical order is returned.
+static const symbol_entry_t *lookup_by_address(const symbol_table_t *table, uint16_t address)
+{
+    if (!table || table->count == 0)
+        return NULL;
+
+    size_t position = lower_bound(table, address);
+    if (position < table->count && table->entries[position].address == address)
+        return &table->entries[position];
+
+    return NULL;
+}
+
 const symbol_entry_t *symbols_lookup_by_address(const symbol_table_t *table, uint16_t address)
+{
+    SYMBOLS_QUERY(SYMBOL_QUERY_LOOKUP_BY_ADDRESS, const symbol_entry_t *, lookup_by_address(table, address));
+}
+
+/// @brief Find the entry with the highest address <= 'address' among the types in 'type_mask'
+/// @param table Pointer to the (sorted) symbol table
+/// @param address Query address
+/// @param type_mask Set of SYMBOL_TYPE_MASK() bits to consider
+/// @return The last matching entry in canonical order at that address (for
+///         LINE entries: the one with the highest line), or NULL
+///
+/// Masks that leave out some types search the type partitions of the types
+/// in the mask; otherwise this is a binary search that steps back over
+/// entries of other types.
+static const symbol_entry_t *lookup_floor(const symbol_table_t *table, uint16_t address, unsigned type_mask)
 {
     if (!table || table->count == 0)
         return NULL;
 
-    // Create a temporary entry for searching
-    symbol_entry_t key = {.address = address};
+    const unsigned partition_mask = SYMBOL_TYPE_MASK(SYMBOL_TYPE_PARTITIONS) - 1;
+    if ((type_mask & partition_mask) != partition_mask)
+    {
+        const struct symbol_index *index = symbols_index_get(table, SYMBOL_INDEX_TYPES);
+        if (index && (index->type_other == 0 || (type_mask & ~partition_mask) == 0))
+        {
+            // Entries keep their table order within a partition, so the
+            // answer is the type floor with the highest position
+            size_t best = 0; // Position + 1
+            for (unsigned type = 0; type < SYMBOL_TYPE_PARTITIONS; type++)
+            {
+                if (!(type_mask & SYMBOL_TYPE_MASK(type)))
+                    continue;
+
+                size_t k = symbols_search_type_lower_bound(index, type, (uint32_t)address + 1);
+                if (k > index->type_start[type] && index->type_pos[k - 1] + 1 > best)
+                    best = index->type_pos[k - 1] + 1;
+            }
+            return best ? &table->entries[best - 1] : NULL;
+        }
+    }
+
+    size_t end = upper_bound(table, address);
+    const struct symbol_index *packed = symbols_index_get(table, SYMBOL_INDEX_PACKED);
+    if (packed)
+    {
+        for (size_t i = end; i-- > 0;)
+        {
+            if (type_mask & SYMBOL_TYPE_MASK(packed->types[i]))
+                return &table->entries[i];
+        }
+        return NULL;
+    }
+
+    for (size_t i = end; i-- > 0;)
+    {
+        const symbol_entry_t *entry = &table->entries[i];
+        if (type_mask & SYMBOL_TYPE_MASK(entry->type))
+            return entry;
+    }
 
-    // Use binary search to find the entry
-    symbol_entry_t *result = bsearch(&key, table->entries, table->count,
-                                     sizeof(symbol_entry_t), compare_entries_by_address);
+    return NULL;
+}
 
-    return result;
+const symbol_entry_t *symbols_lookup_floor(const symbol_table_t *table, uint16_t address, unsigned type_mask)
+{
+    SYMBOLS_QUERY(SYMBOL_QUERY_LOOKUP_FLOOR, const symbol_entry_t *, lookup_floor(table, address, type_mask));
 }
 
-// Look up a symbol by name (linear search)
-const symbol_entry_t *symbols_lookup_by_name(const symbol_table_t *table, const char *name)
+/// @brief Call 'callback' for every entry with lo <= address <= hi, in canonical order
+/// @param table Pointer to the (sorted) symbol table
+/// @param lo Lowest address, inclusive
+/// @param hi Highest address, inclusive
+/// @param callback Called per entry; return false to stop early
+/// @param user_data Passed through to the callback
+/// @return Number of entries passed to the callback
+static size_t lookup_range(const symbol_table_t *table, uint16_t lo, uint16_t hi,
+                           symbol_range_callback_t callback, void *user_data)
+{
+    if (!table || !callback || lo > hi)
+        return 0;
+
+    // Both ends come from the address search
+    size_t begin = lower_bound(table, lo);
+    size_t end = upper_bound(table, hi);
+
+    size_t visited = 0;
+    for (size_t i = begin; i < end; i++)
+    {
+        visited++;
+        if (!callback(&table->entries[i], user_data))
+            break;
+    }
+
+    return visited;
+}
+
+size_t symbols_lookup_range(const symbol_table_t *table, uint16_t lo, uint16_t hi,
+                            symbol_range_callback_t callback, void *user_data)
+{
+    SYMBOLS_QUERY(SYMBOL_QUERY_LOOKUP_RANGE, size_t, lookup_range(table, lo, hi, callback, user_data));
+}
+
+// Look up a symbol by name, using the name hash (built on first use)
+static const symbol_entry_t *lookup_by_name(const symbol_table_t *table, const char *name)
 {
     if (!table || !name || table->count == 0)
         return NULL;
 
+    // Names are interned, so a name that is not in the pool is not in the
+    // table, and a pooled name can be matched by pointer
+    const char *pooled = symbols_strpool_find(table->strings, name);
+    if (!pooled)
+        return NULL;
+
+    const struct symbol_index *index = symbols_index_get(table, SYMBOL_INDEX_NAMES);
+    if (index)
+    {
+        uint32_t id = symbols_strpool_id(pooled);
+        const struct symbol_index *packed = symbols_index_get(table, SYMBOL_INDEX_NAMES | SYMBOL_INDEX_PACKED);
+        size_t mask = index->name_slot_count - 1;
+        size_t slot = symbols_index_hash_id(id) & mask;
+        while (index->name_slots[slot] != 0)
+        {
+            uint32_t position = index->name_slots[slot] - 1;
+            if (packed ? packed->name_ids[position] == id + 1 : table->entries[position].name == pooled)
+                return &table->entries[position];
+            slot = (slot + 1) & mask;
+        }
+        return NULL;
+    }
+
+    // Out of memory for the index: fall back to a linear search
     for (size_t i = 0; i < table->count; i++)
     {
-        if (table->entries[i].name && strcmp(table->entries[i].name, name) == 0)
+        if (table->entries[i].name == pooled)
         {
             return &table->entries[i];
         }
@@ -452,13 +985,170 @@ const symbol_entry_t *symbols_lookup_by_name(const symbol_table_t *table, const
     return NULL;
 }
 
-// Sort the symbol table by address (required for bsearch lookups)
+const symbol_entry_t *symbols_lookup_by_name(const symbol_table_t *table, const char *name)
+{
+    SYMBOLS_QUERY(SYMBOL_QUERY_LOOKUP_BY_NAME, const symbol_entry_t *, lookup_by_name(table, name));
+}
+
+// Get the next entry (in table order) with the same name as 'entry'
+static const symbol_entry_t *lookup_next_by_name(const symbol_table_t *table, const symbol_entry_t *entry)
+{
+    if (!table || !entry || !entry->name ||
+        entry < table->entries || entry >= table->entries + table->count)
+        return NULL;
+
+    size_t position = (size_t)(entry - table->entries);
+
+    const struct symbol_index *index = symbols_index_get(table, SYMBOL_INDEX_NAMES);
+    if (index)
+    {
+        uint32_t next = index->name_next[position];
+        return next ? &table->entries[next - 1] : NULL;
+    }
+
+    for (size_t i = position + 1; i < table->count; i++)
+    {
+        if (table->entries[i].name == entry->name)
+            return &table->entries[i];
+    }
+
+    return NULL;
+}
+
+const symbol_entry_t *symbols_lookup_next_by_name(const symbol_table_t *table, const symbol_entry_t *entry)
+{
+    SYMBOLS_QUERY(SYMBOL_QUERY_LOOKUP_NEXT_BY_NAME, const symbol_entry_t *, lookup_next_by_name(table, entry));
+}
+
+/// @brief Sort the symbol table into canonical order (required for lookups)
+/// @param table Pointer to the symbol table
+///
+/// Entries are ordered by address; entries at the same address by type
+/// (FUNCTION, VARIABLE, FILE, LINE), then by line number, and otherwise keep
+/// their relative order.  The order is therefore deterministic for a given
+/// load sequence, which the floor and range lookups rely on.
 void symbols_sort_by_address(symbol_table_t *table)
 {
-    if (!table || table->count < 2)
+    if (!table || table->frozen || table->count < 2)
         return;
 
-    qsort(table->entries, table->count, sizeof(symbol_entry_t), compare_entries_by_address);
+    uint64_t start = symbols_profile_start();
+    sort_key_t *keys = malloc(table->count * sizeof(sort_key_t));
+    symbol_entry_t *sorted = malloc(table->capacity * sizeof(symbol_entry_t));
+    SYMBOLS_PROFILE_ADD(allocations, (keys != NULL) + (sorted != NULL));
+    if (keys && sorted && table->count <= UINT32_MAX)
+    {
+        for (size_t i = 0; i < table->count; i++)
+            keys[i] = make_sort_key(&table->entries[i], i);
+        qsort(keys, table->count, sizeof(sort_key_t), compare_sort_keys);
+
+        for (size_t i = 0; i < table->count; i++)
+            sorted[i] = table->entries[keys[i].position];
+
+        free(table->entries);
+        table->entries = sorted;
+        sorted = NULL;
+    }
+    else
+    {
+        // Out of memory: still sort by address, without the tie-breaks
+        qsort(table->entries, table->count, sizeof(symbol_entry_t), compare_entries_by_address);
+    }
+    free(keys);
+    free(sorted);
+    symbols_profile_end(SYMBOL_LOAD_PHASE_SORT, start, table->count);
+
+    // Entry positions changed; the merge index is rebuilt on the next add
+    table->merge_valid = false;
+    symbols_index_invalidate(table);
+    rebuild_sorted_indices(table);
+}
+
+// Complete a name prefix from the sorted entry names
+static size_t complete_name(const symbol_table_t *table, const char *prefix,
+                            const char **names, size_t max)
+{
+    if (!table || !prefix || (!names && max > 0))
+        return 0;
+
+    const struct symbol_index *index = symbols_index_get(table, SYMBOL_INDEX_SORTED_NAMES);
+    if (!index)
+        return 0;
+
+    // First name >= prefix; every name with the prefix follows it
+    size_t lo = 0, hi = index->sorted_name_count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strcmp(index->sorted_names[mid], prefix) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    size_t length = strlen(prefix);
+    size_t count = 0;
+    for (size_t i = lo; i < index->sorted_name_count && count < max; i++)
+    {
+        if (strncmp(index->sorted_names[i], prefix, length) != 0)
+            break;
+        names[count++] = index->sorted_names[i];
+    }
+    return count;
+}
+
+size_t symbols_complete_name(const symbol_table_t *table, const char *prefix,
+                             const char **names, size_t max)
+{
+    SYMBOLS_QUERY(SYMBOL_QUERY_COMPLETE_NAME, size_t, complete_name(table, prefix, names, max));
+}
+
+/// @brief Ends the load phase: builds all indices and makes the table read-only
+/// @param table Pointer to the symbol table
+/// @return True if the table is frozen
+///
+/// The table is sorted into canonical order first, so entry pointers taken
+/// before freezing are invalid afterwards.
+bool symbols_freeze(symbol_table_t *table)
+{
+    if (!table)
+        return false;
+    if (table->frozen)
+        return true;
+
+    symbols_sort_by_address(table);
+
+    // No more adds: drop the merge index and the spare entry capacity
+    free(table->merge_slots);
+    table->merge_slots = NULL;
+    table->merge_slot_count = 0;
+    table->merge_used = 0;
+    table->merge_valid = false;
+
+    if (table->count > 0 && table->count < table->capacity)
+    {
+        symbol_entry_t *entries = realloc(table->entries, table->count * sizeof(symbol_entry_t));
+        if (entries)
+        {
+            table->entries = entries;
+            table->capacity = table->count;
+            table->generation = symbols_cache_next_generation();
+        }
+    }
+
+    unsigned parts = SYMBOL_INDEX_ALL;
+    if (!table->line_index_enabled)
+        parts &= ~SYMBOL_INDEX_LINE_MAP;
+    if (!symbols_index_get(table, parts))
+        return false;
+
+    table->frozen = true;
+    return true;
+}
+
+bool symbols_is_frozen(const symbol_table_t *table)
+{
+    return table && table->frozen;
 }
 
 // Dump all symbols to stdout for debugging
@@ -483,14 +1173,18 @@ void symbols_dump_all(const symbol_table_t *table)
     }
 }
 
-/// @brief Compare two filenames, matching on basename if full paths differ.
-/// Handles the case where the srcmap stores "hello.c" but the client sends
-/// "/home/user/repos/hello.c", or vice versa.
-static bool filename_match(const char *stored, const char *req_basename)
+// First index in lines[begin, end) whose line is >= 'line'
+static uint32_t lines_lower_bound(const int32_t *lines, uint32_t begin, uint32_t end, int line)
 {
-    const char *stored_base = strrchr(stored, '/');
-    stored_base = stored_base ? stored_base + 1 : stored;
-    return strcmp(stored_base, req_basename) == 0;
+    while (begin < end)
+    {
+        uint32_t mid = begin + (end - begin) / 2;
+        if (lines[mid] < line)
+            begin = mid + 1;
+        else
+            end = mid;
+    }
+    return begin;
 }
 
 // Find address for a source location
@@ -500,7 +1194,7 @@ static bool filename_match(const char *stored, const char *req_basename)
 /// @param diff How many lines diff to tind a valid addreess  (it != 0 if the address is not exact)
 /// @param line Line number to find
 /// @return True if the address was found, false otherwise
-bool symbols_find_address(const symbol_table_t *table, const char *filename, uint16_t *address, uint16_t *diff,int line)
+static bool find_address(const symbol_table_t *table, const char *filename, uint16_t *address, uint16_t *diff,int line)
 {
     if (!table || !filename)
         return 0;
@@ -511,52 +1205,112 @@ bool symbols_find_address(const symbol_table_t *table, const char *filename, uin
     const char *req_basename = strrchr(filename, '/');
     req_basename = req_basename ? req_basename + 1 : filename;
 
-    // First, find the file entry (try exact match, then basename)
+    // First, find the file entry: the first FILE entry in table order whose
+    // filename matches exactly or by basename.  An exact match has the same
+    // basename too, so the candidates are the files on the basename chain.
     const symbol_entry_t *file_entry = NULL;
-    for (size_t i = 0; i < table->count; i++)
+    const struct symbol_files *files = table->files;
+    const struct symbol_index *index = symbols_index_get(table, SYMBOL_INDEX_FILE_ENTRIES | SYMBOL_INDEX_FILE_LINES);
+    if (index)
     {
-        if (table->entries[i].type == SYMBOL_TYPE_FILE &&
-            table->entries[i].filename != NULL &&
-            (strcmp(table->entries[i].filename, filename) == 0 ||
-             filename_match(table->entries[i].filename, req_basename)))
+        uint32_t first = 0;
+        for (uint32_t file = symbols_files_find_basename(files, req_basename);
+             file != SYMBOL_FILE_NONE;
+             file = files->next_same_base[file] - 1)
         {
-            file_entry = &table->entries[i];
-            break;
+            uint32_t position = index->file_entry[file];
+            if (position != 0 && (first == 0 || position < first))
+                first = position;
+        }
+        if (first != 0)
+            file_entry = &table->entries[first - 1];
+    }
+    else
+    {
+        for (size_t i = 0; i < table->count; i++)
+        {
+            if (table->entries[i].type != SYMBOL_TYPE_FILE || table->entries[i].filename == NULL)
+                continue;
+
+            uint32_t file = symbols_files_id(files, table->entries[i].filename);
+            if (file != SYMBOL_FILE_NONE && strcmp(files->basenames[file], req_basename) == 0)
+            {
+                file_entry = &table->entries[i];
+                break;
+            }
         }
     }
     if (!file_entry)
         return false;
 
-    // Use the matched filename for line lookups
+    // Use the matched filename for line lookups.  Filenames are interned in
+    // the table's string pool, so equal names share one pointer.
     const char *match_name = file_entry->filename;
 
-    // Then find the closest line number entry
+    // Then find the closest line number entry.  Among equally close lines
+    // the first entry in table order wins.
     *diff = 0;
     uint16_t closest_address = 0;
     int closest_line_diff = INT_MAX;
 
-    for (size_t i = 0; i < table->count; i++)
+    if (index)
     {
-        if (table->entries[i].type == SYMBOL_TYPE_LINE &&
-            table->entries[i].filename != NULL &&
-            strcmp(table->entries[i].filename, match_name) == 0)
+        // Binary search in the file's line table.  The closest line is the
+        // first line >= the requested one or the last line below it; the
+        // first entry of a line's run has the lowest position.
+        uint32_t file_id = symbols_files_id(files, match_name);
+        uint32_t begin = index->file_line_start[file_id];
+        uint32_t end = index->file_line_start[file_id + 1];
+        const int32_t *lines = index->file_line_num;
+
+        uint32_t above = lines_lower_bound(lines, begin, end, line);
+        size_t best = SIZE_MAX;
+        if (above < end)
         {
-            int line_diff = abs(table->entries[i].line - line);
-            if (line_diff < closest_line_diff)
+            best = index->file_line_pos[above];
+            closest_line_diff = abs(lines[above] - line);
+        }
+        if (above > begin)
+        {
+            uint32_t below = lines_lower_bound(lines, begin, above, lines[above - 1]);
+            int below_diff = abs(lines[below] - line);
+            if (below_diff < closest_line_diff ||
+                (below_diff == closest_line_diff && index->file_line_pos[below] < best))
             {
-                closest_line_diff = line_diff;
-                closest_address = table->entries[i].address;
+                best = index->file_line_pos[below];
+                closest_line_diff = below_diff;
+            }
+        }
+        if (best != SIZE_MAX)
+            closest_address = table->entries[best].address;
+    }
+    else
+    {
+        for (size_t i = 0; i < table->count; i++)
+        {
+            if (table->entries[i].type == SYMBOL_TYPE_LINE &&
+                table->entries[i].filename == match_name)
+            {
+                int line_diff = abs(table->entries[i].line - line);
+                if (line_diff < closest_line_diff)
+                {
+                    closest_line_diff = line_diff;
+                    closest_address = table->entries[i].address;
+                }
             }
         }
     }
-
 
     *diff = closest_line_diff;
     *address = closest_address;
-    ;
     return true;
 }
 
+bool symbols_find_address(const symbol_table_t *table, const char *filename, uint16_t *address, uint16_t *diff,int line)
+{
+    SYMBOLS_QUERY(SYMBOL_QUERY_FIND_ADDRESS, bool, find_address(table, filename, address, diff, line));
+}
+
 /// Floor-lookup helper: find the LINE entry whose address is the highest
 /// value that is still <= the query address, AND that belongs to the same
 /// source file region.  Returns NULL if the address is outside any mapped
@@ -572,83 +1326,321 @@ find_source_entry(const symbol_table_t *table, uint16_t address)
     if (!table || table->count == 0)
         return NULL;
 
-    // Floor lookup: find highest address <= query.
-    // Among ties (same address), prefer the higher line number.
-    // Entries are sorted by address after loading.
-    const symbol_entry_t *floor = NULL;
-
-    for (size_t i = 0; i < table->count; i++)
+    // With the line index enabled the whole lookup below is precomputed
+    if (table->line_index_enabled)
     {
-        if (table->entries[i].type != SYMBOL_TYPE_LINE)
-            continue;
-        if (table->entries[i].address > address)
-            break; // sorted — no more candidates
-        // Pick this entry (same or higher address still <= query).
-        // Among entries at the same address, prefer higher line number.
-        if (!floor ||
-            table->entries[i].address > floor->address ||
-            (table->entries[i].address == floor->address &&
-             table->entries[i].line > floor->line))
+        const struct symbol_index *index = symbols_index_get(table, SYMBOL_INDEX_LINE_MAP);
+        if (index)
         {
-            floor = &table->entries[i];
+            uint32_t position = index->line_map[address];
+            return position ? &table->entries[position - 1] : NULL;
         }
     }
 
-    if (!floor)
-        return NULL;
+    symbol_range_cache_t *cache = &symbols_thread_cache.source;
+    const void *cached;
+    if (symbols_cache_lookup(cache, table, table->generation, address, &cached))
+        return cached;
 
-    // Find the next LINE entry after the floor (next source line).
-    const symbol_entry_t *next = NULL;
-    for (size_t i = 0; i < table->count; i++)
+    // Floor lookup: find highest address <= query.
+    // Among ties (same address), prefer the higher line number, and among
+    // equal lines the first entry.  Entries are sorted by address after
+    // loading, with LINE entries at one address ordered by line.  'next' is
+    // the address of the first LINE entry above the floor (0x10000 if none)
+    // and 'last' the address of the last LINE entry.
+    const symbol_entry_t *floor = NULL;
+    uint32_t next = 0x10000;
+    uint32_t last = 0;
+    const struct symbol_index *index = symbols_index_get(table, SYMBOL_INDEX_TYPES);
+    if (index)
     {
-        if (table->entries[i].type != SYMBOL_TYPE_LINE)
-            continue;
-        if (table->entries[i].address > floor->address)
+        // Only the LINE partition is searched
+        const uint32_t *lines = index->type_pos;
+        size_t begin = index->type_start[SYMBOL_TYPE_LINE];
+        size_t end = index->type_start[SYMBOL_TYPE_LINE + 1];
+        size_t k = symbols_search_type_lower_bound(index, SYMBOL_TYPE_LINE, (uint32_t)address + 1);
+        if (k < end)
+            next = index->type_addr[k];
+        if (end > begin)
+            last = index->type_addr[end - 1];
+        if (k > begin)
         {
-            next = &table->entries[i];
-            break;
+            floor = &table->entries[lines[--k]];
+            while (k > begin &&
+                   index->type_addr[k - 1] == floor->address &&
+                   table->entries[lines[k - 1]].line == floor->line)
+                floor = &table->entries[lines[--k]];
         }
     }
+    else
+    {
+        size_t end = upper_bound(table, address);
+        for (size_t i = end; i-- > 0;)
+        {
+            if (table->entries[i].type == SYMBOL_TYPE_LINE)
+            {
+                floor = &table->entries[i];
+                break;
+            }
+        }
+        while (floor && floor > table->entries &&
+               floor[-1].type == SYMBOL_TYPE_LINE &&
+               floor[-1].address == floor->address &&
+               floor[-1].line == floor->line)
+            floor--;
 
-    if (next)
+        for (size_t i = end; i < table->count; i++)
+        {
+            if (table->entries[i].type == SYMBOL_TYPE_LINE)
+            {
+                next = table->entries[i].address;
+                break;
+            }
+        }
+        for (size_t i = table->count; i-- > 0;)
+        {
+            if (table->entries[i].type == SYMBOL_TYPE_LINE)
+            {
+                last = table->entries[i].address;
+                break;
+            }
+        }
+    }
+
+    if (!floor)
     {
-        // If query is past the next line's address, we overshot — the
-        // query is in code belonging to the next line or beyond.
-        // But that's fine; the floor entry is still valid as long as
-        // address < next->address.  If address >= next->address we
-        // should have matched next instead (the loop above handles it).
-        //
-        // Check file boundary: if the next entry is from a DIFFERENT file
-        // and address >= next->address, then address is in that file.
-        // (This case shouldn't happen due to the break above, but guard.)
+        // Unmapped up to the first LINE entry
+        symbols_cache_store(cache, table, table->generation, 0, next, NULL);
+        return NULL;
     }
-    else
+
+    // If the floor is at the address of the last LINE entry, there is no
+    // next source line.  The query address should not be too far past the
+    // last mapped line -- that means we're in library or CRT code.  Use a
+    // generous bound because C statements can compile to many instructions
+    // (arg pushes, calls, stores).
+    if (last == floor->address && (address - floor->address) > 32)
     {
-        // floor is the last LINE entry.  The query address should not be
-        // too far past the last mapped line -- that means we're in library
-        // or CRT code.  Use a generous bound because C statements can
-        // compile to many instructions (arg pushes, calls, stores).
-        if ((address - floor->address) > 32)
-            return NULL;
+        symbols_cache_store(cache, table, table->generation, last + 33, 0x10000, NULL);
+        return NULL;
     }
 
+    // The answer holds up to the next LINE address, or for the 32 addresses
+    // past the last one
+    uint32_t end = last != floor->address ? next : (uint32_t)floor->address + 33;
+    symbols_cache_store(cache, table, table->generation, floor->address, end, floor);
+
     return floor;
 }
 
 // Get source file for an address
-const char *symbols_get_file(const symbol_table_t *table, uint16_t address)
+static const char *get_file(const symbol_table_t *table, uint16_t address)
 {
     const symbol_entry_t *entry = find_source_entry(table, address);
     return entry ? entry->filename : NULL;
 }
 
+const char *symbols_get_file(const symbol_table_t *table, uint16_t address)
+{
+    SYMBOLS_QUERY(SYMBOL_QUERY_GET_FILE, const char *, get_file(table, address));
+}
+
+// List the source files referenced by the table
+static size_t get_source_files(const symbol_table_t *table, const char **paths, size_t max)
+{
+    if (!table)
+        return 0;
+
+    // End-of-file markers use an empty filename; that is not a source
+    size_t count = 0;
+    for (size_t id = 0; id < table->files->count; id++)
+    {
+        const char *path = table->files->paths[id];
+        if (path[0] == '\0')
+            continue;
+        if (paths && count < max)
+            paths[count] = path;
+        count++;
+    }
+    return count;
+}
+
+size_t symbols_get_source_files(const symbol_table_t *table, const char **paths, size_t max)
+{
+    SYMBOLS_QUERY(SYMBOL_QUERY_GET_SOURCE_FILES, size_t, get_source_files(table, paths, max));
+}
+
 // Get line number for an address
-int symbols_get_line(const symbol_table_t *table, uint16_t address)
+static int get_line(const symbol_table_t *table, uint16_t address)
 {
     const symbol_entry_t *entry = find_source_entry(table, address);
     return entry ? entry->line : 0;
 }
 
+int symbols_get_line(const symbol_table_t *table, uint16_t address)
+{
+    SYMBOLS_QUERY(SYMBOL_QUERY_GET_LINE, int, get_line(table, address));
+}
+
+// Below this many addresses a batch is resolved one address at a time
+#define BATCH_MAP_MIN 4096
+// Fewest addresses worth handing to a thread of their own
+#define BATCH_THREAD_MIN (1u << 18)
+
+typedef struct
+{
+    const symbol_table_t *table;
+    const uint32_t *line_map;
+    const uint16_t *addrs;
+    symbol_location_t *out;
+    size_t begin;
+    size_t end;
+} batch_chunk_t;
+
+static void *resolve_chunk(void *arg)
+{
+    const batch_chunk_t *chunk = (const batch_chunk_t *)arg;
+    const symbol_entry_t *entries = chunk->table->entries;
+
+    for (size_t i = chunk->begin; i < chunk->end; i++)
+    {
+        uint32_t position = chunk->line_map[chunk->addrs[i]];
+        chunk->out[i].filename = position ? entries[position - 1].filename : NULL;
+        chunk->out[i].line = position ? entries[position - 1].line : 0;
+    }
+    return NULL;
+}
+
+// Resolve a batch through a line map, on several threads if worthwhile
+static void resolve_mapped(const symbol_table_t *table, const uint32_t *line_map,
+                           const uint16_t *addrs, size_t count, symbol_location_t *out,
+                           unsigned threads)
+{
+    batch_chunk_t whole = {table, line_map, addrs, out, 0, count};
+
+#if SYMBOLS_HAVE_PTHREAD
+    if (threads > count / BATCH_THREAD_MIN)
+        threads = (unsigned)(count / BATCH_THREAD_MIN);
+    if (threads > 1)
+    {
+        pthread_t *ids = malloc(threads * sizeof(pthread_t));
+        batch_chunk_t *chunks = malloc(threads * sizeof(batch_chunk_t));
+        if (ids && chunks)
+        {
+            for (unsigned t = 0; t < threads; t++)
+            {
+                chunks[t] = whole;
+                chunks[t].begin = count / threads * t;
+                chunks[t].end = t + 1 == threads ? count : count / threads * (t + 1);
+            }
+
+            // The calling thread takes the first chunk itself
+            unsigned started = 1;
+            while (started < threads &&
+                   pthread_create(&ids[started], NULL, resolve_chunk, &chunks[started]) == 0)
+                started++;
+
+            resolve_chunk(&chunks[0]);
+            for (unsigned t = 1; t < started; t++)
+                pthread_join(ids[t], NULL);
+
+            // Chunks whose thread could not be started
+            for (unsigned t = started; t < threads; t++)
+                resolve_chunk(&chunks[t]);
+
+            free(ids);
+            free(chunks);
+            return;
+        }
+        free(ids);
+        free(chunks);
+    }
+#else
+    (void)threads;
+#endif
+
+    resolve_chunk(&whole);
+}
+
+/// @brief Resolves addresses to source locations in bulk
+/// @param table Pointer to the (sorted) symbol table
+/// @param addrs Addresses to resolve
+/// @param count Number of addresses
+/// @param out Receives one location per address, in input order
+/// @param threads Maximum number of threads to use
+/// @return True on success
+///
+/// With 16-bit addresses, bucketing the input by address and merging it
+/// with the sorted line entries amounts to filling the line map: one pass
+/// over the LINE entries gives the answer for every address.  The inputs
+/// are then scattered through that map.  The table's own line index is
+/// used when it is enabled; otherwise the map is built for this call.
+static bool resolve_batch(const symbol_table_t *table, const uint16_t *addrs, size_t count,
+                          symbol_location_t *out, unsigned threads)
+{
+    if (!table || (count > 0 && (!addrs || !out)))
+        return false;
+
+    const struct symbol_index *index = table->line_index_enabled ? symbols_index_get(table, SYMBOL_INDEX_LINE_MAP) : NULL;
+    if (index)
+    {
+        resolve_mapped(table, index->line_map, addrs, count, out, threads);
+        return true;
+    }
+
+    if (count < BATCH_MAP_MIN)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            const symbol_entry_t *entry = find_source_entry(table, addrs[i]);
+            out[i].filename = entry ? entry->filename : NULL;
+            out[i].line = entry ? entry->line : 0;
+        }
+        return true;
+    }
+
+    uint32_t *line_map = calloc(SYMBOL_LINE_MAP_SIZE, sizeof(uint32_t));
+    if (!line_map)
+        return false;
+
+    symbols_index_fill_line_map(table, line_map);
+    resolve_mapped(table, line_map, addrs, count, out, threads);
+    free(line_map);
+    return true;
+}
+
+bool symbols_resolve_batch_threaded(const symbol_table_t *table, const uint16_t *addrs, size_t count,
+                                    symbol_location_t *out, unsigned threads)
+{
+    SYMBOLS_QUERY(SYMBOL_QUERY_RESOLVE_BATCH, bool, resolve_batch(table, addrs, count, out, threads));
+}
+
+// Resolve many addresses at once
+bool symbols_resolve_batch(const symbol_table_t *table, const uint16_t *addrs, size_t count,
+                           symbol_location_t *out)
+{
+    SYMBOLS_QUERY(SYMBOL_QUERY_RESOLVE_BATCH, bool, resolve_batch(table, addrs, count, out, 1));
+}
+
+// Enable or disable the direct-mapped address -> line index
+bool symbols_set_line_index(symbol_table_t *table, bool enabled)
+{
+    if (!table)
+        return false;
+
+    // A frozen table keeps the indices it was frozen with
+    if (table->frozen)
+        return enabled == table->line_index_enabled;
+
+    table->line_index_enabled = enabled;
+    if (!enabled)
+    {
+        symbols_index_invalidate(table);
+        return true;
+    }
+    return symbols_index_get(table, SYMBOL_INDEX_LINE_MAP) != NULL;
+}
+
 // Check if an entry represents a line number
 bool symbols_is_line_entry(const symbol_entry_t *entry)
 {
@@ -659,7 +1651,7 @@ bool symbols_is_line_entry(const symbol_entry_t *entry)
 /// @param table Pointer to the symbol table containing line number to address mappings
 /// @param current_address The current memory address to find the next line from
 /// @return The memory address of the next line in the same source file, or 0 if no next line exists
-uint16_t symbols_get_next_line_address(const symbol_table_t *table, uint16_t current_address)
+static uint16_t next_line_address(const symbol_table_t *table, uint16_t current_address)
 {
     if (!table)
         return 0;
@@ -669,23 +1661,31 @@ uint16_t symbols_get_next_line_address(const symbol_table_t *table, uint16_t cur
     if (!current)
         return 0;
 
-    // Find the next line entry in the same file at a STRICTLY HIGHER address
-    const symbol_entry_t *next = NULL;
-    uint16_t next_address = UINT16_MAX;
+    // The floor is the highest LINE entry at or below the query, so every
+    // LINE entry above the floor's address is also above the query: the
+    // answer is the floor's precomputed successor in its file
+    const struct symbol_index *index = symbols_index_get(table, SYMBOL_INDEX_LINE_NEXT);
+    if (index)
+    {
+        uint32_t next = index->line_next[current - table->entries];
+        return next ? table->entries[next - 1].address : 0;
+    }
 
-    for (size_t i = 0; i < table->count; i++)
+    // Find the next line entry in the same file at a STRICTLY HIGHER address:
+    // entries are sorted, so it is the first one past the query address
+    for (size_t i = upper_bound(table, current_address); i < table->count; i++)
     {
         if (table->entries[i].type == SYMBOL_TYPE_LINE &&
-            strcmp(table->entries[i].filename, current->filename) == 0 &&
-            table->entries[i].address > current_address &&
-            table->entries[i].address < next_address)
-        {
-            next = &table->entries[i];
-            next_address = table->entries[i].address;
-        }
+            table->entries[i].filename == current->filename)
+            return table->entries[i].address;
     }
 
-    return next ? next->address : 0;
+    return 0;
+}
+
+uint16_t symbols_get_next_line_address(const symbol_table_t *table, uint16_t current_address)
+{
+    SYMBOLS_QUERY(SYMBOL_QUERY_GET_NEXT_LINE_ADDRESS, uint16_t, next_line_address(table, current_address));
 }
 
 // Load binary code from a.out file
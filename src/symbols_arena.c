@@ -0,0 +1,162 @@
+#include "symbols_arena.h"
+#include "symbols_profile.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+// Default block size; larger requests get a block of their own size
+#define ARENA_BLOCK_SIZE 65536
+
+struct symbol_arena_block
+{
+    struct symbol_arena_block *next;
+    size_t used;
+    size_t size;
+    // Block storage follows, aligned for any object type
+    union
+    {
+        long double ld;
+        void *p;
+        uint64_t u;
+    } data[];
+};
+
+static char *block_data(struct symbol_arena_block *block)
+{
+    return (char *)block->data;
+}
+
+struct symbol_arena *symbols_arena_create(void)
+{
+    return calloc(1, sizeof(struct symbol_arena));
+}
+
+void symbols_arena_free(struct symbol_arena *arena)
+{
+    if (!arena)
+        return;
+
+    struct symbol_arena_block *block = arena->blocks;
+    while (block)
+    {
+        struct symbol_arena_block *next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
+
+void symbols_arena_reset(struct symbol_arena *arena)
+{
+    if (!arena || !arena->blocks)
+        return;
+
+    struct symbol_arena_block *keep = arena->blocks;
+    for (struct symbol_arena_block *b = arena->blocks; b; b = b->next)
+    {
+        if (b->size > keep->size)
+            keep = b;
+    }
+
+    struct symbol_arena_block *block = arena->blocks;
+    while (block)
+    {
+        struct symbol_arena_block *next = block->next;
+        if (block != keep)
+            free(block);
+        block = next;
+    }
+
+    keep->next = NULL;
+    keep->used = 0;
+    arena->blocks = keep;
+    arena->block_count = 1;
+    arena->bytes_used = 0;
+    arena->bytes_reserved = keep->size;
+}
+
+void *symbols_arena_alloc(struct symbol_arena *arena, size_t size, size_t align)
+{
+    if (!arena || align == 0 || (align & (align - 1)) != 0)
+        return NULL;
+
+    struct symbol_arena_block *block = arena->blocks;
+    size_t offset = 0;
+    if (block)
+        offset = (block->used + align - 1) & ~(align - 1);
+
+    if (!block || offset > block->size || block->size - offset < size)
+    {
+        // Large requests get a dedicated block behind the head, so the
+        // head block keeps serving small allocations
+        bool dedicated = block && size > ARENA_BLOCK_SIZE / 4;
+        size_t block_size = size + align > ARENA_BLOCK_SIZE ? size + align : ARENA_BLOCK_SIZE;
+        if (dedicated)
+            block_size = size + align;
+
+        struct symbol_arena_block *fresh = malloc(sizeof(*fresh) + block_size);
+        if (!fresh)
+            return NULL;
+        fresh->size = block_size;
+        fresh->used = 0;
+        arena->block_count++;
+        arena->bytes_reserved += block_size;
+        SYMBOLS_PROFILE_ADD(allocations, 1);
+
+        if (dedicated)
+        {
+            fresh->next = block->next;
+            block->next = fresh;
+        }
+        else
+        {
+            fresh->next = arena->blocks;
+            arena->blocks = fresh;
+        }
+        block = fresh;
+        offset = 0;
+    }
+
+    arena->bytes_used += offset - block->used + size;
+    block->used = offset + size;
+    return block_data(block) + offset;
+}
+
+void *symbols_arena_calloc(struct symbol_arena *arena, size_t count, size_t size)
+{
+    if (size != 0 && count > SIZE_MAX / size)
+        return NULL;
+
+    void *p = symbols_arena_alloc(arena, count * size, sizeof(void *));
+    if (p)
+        memset(p, 0, count * size);
+    return p;
+}
+
+char *symbols_arena_strdup(struct symbol_arena *arena, const char *str)
+{
+    size_t len = strlen(str) + 1;
+    char *copy = symbols_arena_alloc(arena, len, 1);
+    if (copy)
+        memcpy(copy, str, len);
+    return copy;
+}
+
+void symbols_arena_add_stats(const struct symbol_arena *arena, symbol_arena_stats_t *stats)
+{
+    if (!arena || !stats)
+        return;
+
+    stats->blocks += arena->block_count;
+    stats->bytes_used += arena->bytes_used;
+    stats->bytes_reserved += arena->bytes_reserved;
+}
+
+size_t symbols_arena_footprint(const struct symbol_arena *arena)
+{
+    if (!arena)
+        return 0;
+
+    return sizeof(*arena) + arena->bytes_reserved +
+           arena->block_count * sizeof(struct symbol_arena_block);
+}
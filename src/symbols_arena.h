@@ -0,0 +1,48 @@
+#ifndef SYMBOLS_ARENA_H
+#define SYMBOLS_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "symbols.h"
+
+// Internal: bump allocator for memory that lives as long as its owner.
+//
+// Allocations are carved out of large blocks and are never freed one by
+// one; the owner releases everything at once with symbols_arena_free() or
+// symbols_arena_reset().  Used for interned strings, debug info strings
+// and variable arrays, and the derived lookup indices.
+
+struct symbol_arena_block;
+
+struct symbol_arena
+{
+    struct symbol_arena_block *blocks; // Newest first; allocations come from the head
+    size_t block_count;
+    size_t bytes_used;     // Bytes handed out, including alignment padding
+    size_t bytes_reserved; // Bytes of block storage obtained from malloc
+};
+
+struct symbol_arena *symbols_arena_create(void);
+
+// Release every block and the arena itself
+void symbols_arena_free(struct symbol_arena *arena);
+
+// Forget all allocations, keeping the largest block for reuse
+void symbols_arena_reset(struct symbol_arena *arena);
+
+// Allocate 'size' bytes aligned to 'align' (a power of two); NULL on failure
+void *symbols_arena_alloc(struct symbol_arena *arena, size_t size, size_t align);
+
+// Allocate zeroed memory for 'count' objects of 'size' bytes
+void *symbols_arena_calloc(struct symbol_arena *arena, size_t count, size_t size);
+
+// Copy a string into the arena
+char *symbols_arena_strdup(struct symbol_arena *arena, const char *str);
+
+// Add this arena's numbers to 'stats'
+void symbols_arena_add_stats(const struct symbol_arena *arena, symbol_arena_stats_t *stats);
+
+// Bytes held from malloc: the arena, its blocks and their headers
+size_t symbols_arena_footprint(const struct symbol_arena *arena);
+
+#endif /* SYMBOLS_ARENA_H */
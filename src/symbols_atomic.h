@@ -0,0 +1,132 @@
+#ifndef SYMBOLS_ATOMIC_H
+#define SYMBOLS_ATOMIC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Internal: the few atomic operations the table handle and the query
+// counters need, on top of the GCC/Clang builtins or the MSVC intrinsics.
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <windows.h>
+
+static inline void *symbols_atomic_load_ptr(void *const volatile *p)
+{
+    return InterlockedCompareExchangePointer((PVOID volatile *)p, NULL, NULL);
+}
+
+static inline void *symbols_atomic_exchange_ptr(void *volatile *p, void *value)
+{
+    return InterlockedExchangePointer((PVOID volatile *)p, value);
+}
+
+static inline size_t symbols_atomic_load(const volatile size_t *p)
+{
+    return (size_t)InterlockedCompareExchangePointer((PVOID volatile *)p, NULL, NULL);
+}
+
+static inline void symbols_atomic_store(volatile size_t *p, size_t value)
+{
+    InterlockedExchangePointer((PVOID volatile *)p, (PVOID)value);
+}
+
+static inline size_t symbols_atomic_add(volatile size_t *p, size_t value)
+{
+#if defined(_WIN64)
+    return (size_t)InterlockedExchangeAdd64((volatile LONG64 *)p, (LONG64)value) + value;
+#else
+    return (size_t)InterlockedExchangeAdd((volatile LONG *)p, (LONG)value) + value;
+#endif
+}
+
+static inline size_t symbols_atomic_sub(volatile size_t *p, size_t value)
+{
+    return symbols_atomic_add(p, (size_t)0 - value);
+}
+
+static inline int symbols_atomic_try_lock(volatile size_t *p)
+{
+    return InterlockedCompareExchangePointer((PVOID volatile *)p, (PVOID)1, NULL) == NULL;
+}
+
+static inline void symbols_atomic_yield(void)
+{
+    SwitchToThread();
+}
+
+static inline uint64_t symbols_atomic_load_relaxed(const volatile uint64_t *p)
+{
+    return *p;
+}
+
+static inline void symbols_atomic_store_relaxed(volatile uint64_t *p, uint64_t value)
+{
+    *p = value;
+}
+
+#else
+#include <sched.h>
+
+static inline void *symbols_atomic_load_ptr(void *const volatile *p)
+{
+    return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+}
+
+static inline void *symbols_atomic_exchange_ptr(void *volatile *p, void *value)
+{
+    return __atomic_exchange_n(p, value, __ATOMIC_SEQ_CST);
+}
+
+static inline size_t symbols_atomic_load(const volatile size_t *p)
+{
+    return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+}
+
+static inline void symbols_atomic_store(volatile size_t *p, size_t value)
+{
+    __atomic_store_n(p, value, __ATOMIC_SEQ_CST);
+}
+
+// Add or subtract, returning the new value
+static inline size_t symbols_atomic_add(volatile size_t *p, size_t value)
+{
+    return __atomic_add_fetch(p, value, __ATOMIC_SEQ_CST);
+}
+
+static inline size_t symbols_atomic_sub(volatile size_t *p, size_t value)
+{
+    return __atomic_sub_fetch(p, value, __ATOMIC_SEQ_CST);
+}
+
+// Take a spin lock word (0 = free); returns nonzero on success
+static inline int symbols_atomic_try_lock(volatile size_t *p)
+{
+    size_t expected = 0;
+    return __atomic_compare_exchange_n(p, &expected, 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline void symbols_atomic_yield(void)
+{
+    sched_yield();
+}
+
+// Counters with a single writer: plain loads and stores that other threads
+// may read, without a locked instruction on the writer's side
+static inline uint64_t symbols_atomic_load_relaxed(const volatile uint64_t *p)
+{
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+static inline void symbols_atomic_store_relaxed(volatile uint64_t *p, uint64_t value)
+{
+    __atomic_store_n(p, value, __ATOMIC_RELAXED);
+}
+
+#endif
+
+static inline void symbols_atomic_unlock(volatile size_t *p)
+{
+    symbols_atomic_store(p, 0);
+}
+
+#endif /* SYMBOLS_ATOMIC_H */
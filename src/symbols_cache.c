@@ -0,0 +1,30 @@
+#include "symbols_cache.h"
+#include "symbols_atomic.h"
+
+SYMBOLS_THREAD_LOCAL struct symbol_thread_cache symbols_thread_cache;
+
+static volatile size_t last_generation;
+
+size_t symbols_cache_next_generation(void)
+{
+    return symbols_atomic_add(&last_generation, 1);
+}
+
+void symbols_get_cache_stats(symbol_cache_stats_t *stats)
+{
+    if (!stats)
+        return;
+
+    stats->source_hits = symbols_thread_cache.source.hits;
+    stats->source_misses = symbols_thread_cache.source.misses;
+    stats->function_hits = symbols_thread_cache.function.hits;
+    stats->function_misses = symbols_thread_cache.function.misses;
+}
+
+void symbols_reset_cache_stats(void)
+{
+    symbols_thread_cache.source.hits = 0;
+    symbols_thread_cache.source.misses = 0;
+    symbols_thread_cache.function.hits = 0;
+    symbols_thread_cache.function.misses = 0;
+}
@@ -0,0 +1,69 @@
+#ifndef SYMBOLS_CACHE_H
+#define SYMBOLS_CACHE_H
+
+#include "symbols.h"
+
+// Internal: per-thread last-hit caches for address lookups.
+//
+// Stepping and tracing look up runs of nearby addresses.  Each lookup
+// that has a cache remembers, per thread, the address range over which
+// its last answer holds, and answers from it while the address stays in
+// the range.  An entry is tied to its table (or debug info) and to the
+// owner's generation, which changes whenever the owner's contents do, so
+// entries never outlive the data they point into.
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SYMBOLS_THREAD_LOCAL __declspec(thread)
+#else
+#define SYMBOLS_THREAD_LOCAL __thread
+#endif
+
+typedef struct
+{
+    const void *owner;  // Table or debug info the range belongs to
+    size_t generation;  // Owner's generation when the range was cached
+    uint32_t start;     // The result holds for start <= address < end
+    uint32_t end;
+    const void *result;
+    size_t hits;
+    size_t misses;
+} symbol_range_cache_t;
+
+struct symbol_thread_cache
+{
+    symbol_range_cache_t source;   // find_source_entry()
+    symbol_range_cache_t function; // symbols_find_function_at()
+};
+
+extern SYMBOLS_THREAD_LOCAL struct symbol_thread_cache symbols_thread_cache;
+
+// A new generation number, unique in the process and never 0
+size_t symbols_cache_next_generation(void);
+
+// Look 'address' up in a cache; counts a hit or a miss
+static inline bool symbols_cache_lookup(symbol_range_cache_t *cache, const void *owner,
+                                        size_t generation, uint16_t address, const void **result)
+{
+    if (cache->owner == owner && cache->generation == generation &&
+        address >= cache->start && address < cache->end)
+    {
+        cache->hits++;
+        *result = cache->result;
+        return true;
+    }
+    cache->misses++;
+    return false;
+}
+
+static inline void symbols_cache_store(symbol_range_cache_t *cache, const void *owner,
+                                       size_t generation, uint32_t start, uint32_t end,
+                                       const void *result)
+{
+    cache->owner = owner;
+    cache->generation = generation;
+    cache->start = start;
+    cache->end = end;
+    cache->result = result;
+}
+
+#endif /* SYMBOLS_CACHE_H */
@@ -0,0 +1,932 @@
+#include "symbols_cache_file.h"
+#include "symbols.h"
+#include "symbols_index.h"
+#include "symbols_strpool.h"
+#include "symbols_files.h"
+#include "symbols_arena.h"
+#include "symbols_search.h"
+#include "symbols_profile.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define SYMBOLS_HAVE_MMAP 1
+#else
+#define SYMBOLS_HAVE_MMAP 0
+#endif
+
+// Table cache file layout: a header, then the sections it lists, each
+// starting at a multiple of 8 bytes.  Every section is a flat array of
+// fixed-width integers (or text), so the index sections are used in place.
+// The header and every section carry a checksum, so a damaged file is
+// rejected rather than answering queries wrongly.  Bump CACHE_VERSION
+// whenever the layout or the meaning of a section changes; files of other
+// versions are rejected, never converted.
+#define CACHE_MAGIC "SYMCACHE"
+#define CACHE_VERSION 2u
+#define CACHE_BYTE_ORDER 0x01020304u
+
+#define CACHE_LINE_INDEX 0x1u // Header flag: the table had its line index enabled
+
+// Parts every cache file carries (the line map only with CACHE_LINE_INDEX)
+#define CACHE_PARTS (SYMBOL_INDEX_ALL & ~SYMBOL_INDEX_LINE_MAP)
+
+enum
+{
+    SECTION_STRINGS,        // Pool records: uint32 id, text, NUL, 4-byte aligned
+    SECTION_STRING_OFFSETS, // uint32 per pool id: offset of its text in STRINGS
+    SECTION_STRING_SLOTS,   // The pool's hash set
+    SECTION_FILES,          // uint32 pool id per file id
+    SECTION_DESC,           // uint8 per entry
+    SECTION_NAME_SLOTS,     // The index parts, as in struct symbol_index
+    SECTION_NAME_NEXT,
+    SECTION_LINE_MAP,
+    SECTION_FILE_LINE_START,
+    SECTION_FILE_LINE_NUM,
+    SECTION_FILE_LINE_POS,
+    SECTION_LINE_NEXT,
+    SECTION_FILE_ENTRY,
+    SECTION_ADDRESSES,
+    SECTION_TYPES,
+    SECTION_LINES,
+    SECTION_FILE_IDS,
+    SECTION_NAME_IDS,
+    SECTION_EYTZINGER,
+    SECTION_EYTZINGER_RANK,
+    SECTION_TYPE_POS,
+    SECTION_TYPE_ADDR,
+    SECTION_SORTED_NAMES,   // uint32 pool id per sorted name
+    SECTION_NAME_TEXT,
+    SECTION_NAME_TEXT_FOLDED,
+    SECTION_NAME_OFFSETS,
+    SECTION_COUNT
+};
+
+struct cache_section
+{
+    uint64_t offset;   // From the start of the file
+    uint64_t size;     // In bytes
+    uint64_t checksum; // checksum() of the 'size' bytes
+};
+
+struct cache_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;  // CACHE_BYTE_ORDER as written by the saving host
+    uint64_t file_size;
+    uint64_t checksum;    // checksum() of the header with this field 0
+    uint32_t flags;       // CACHE_*
+    uint32_t parts;       // SYMBOL_INDEX_* parts stored
+    uint64_t entry_count;
+    uint64_t string_count;
+    uint64_t string_bytes;
+    uint64_t string_slot_count;
+    uint64_t file_count;
+    uint64_t file_line_count;
+    uint64_t name_slot_count;
+    uint64_t sorted_name_count;
+    uint64_t name_text_size;
+    uint64_t type_other;
+    uint32_t type_start[SYMBOL_TYPE_PARTITIONS + 1];
+    struct cache_section sections[SECTION_COUNT];
+};
+
+static uint64_t align8(uint64_t size)
+{
+    return (size + 7) & ~(uint64_t)7;
+}
+
+// Checksum for damage, not tampering: four interleaved xor-multiply lanes
+// over 8-byte words.  Each step is a bijection of the lane, so a change to
+// any word changes the result.
+static uint64_t checksum(const void *data, size_t size)
+{
+    const uint64_t k = 0x9E3779B97F4A7C15u;
+    const unsigned char *p = data;
+    uint64_t lanes[4] = { 1, 2, 3, 4 };
+    size_t i = 0;
+
+    for (; i + 32 <= size; i += 32)
+    {
+        for (unsigned l = 0; l < 4; l++)
+        {
+            uint64_t word;
+            memcpy(&word, p + i + 8 * l, sizeof(word));
+            lanes[l] = (lanes[l] ^ word) * k;
+        }
+    }
+    for (; i < size; i++)
+        lanes[0] = (lanes[0] ^ p[i]) * k;
+
+    uint64_t hash = size;
+    for (unsigned l = 0; l < 4; l++)
+    {
+        hash = (hash ^ lanes[l]) * k;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+struct symbol_cache_file *symbols_cache_file_open(const char *path)
+{
+    struct symbol_cache_file *file = calloc(1, sizeof(struct symbol_cache_file));
+    if (!file)
+        return NULL;
+
+#if SYMBOLS_HAVE_MMAP
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0 && (uint64_t)st.st_size <= SIZE_MAX)
+    {
+        void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            file->data = data;
+            file->size = (size_t)st.st_size;
+            file->mapped = true;
+        }
+    }
+    if (fd >= 0)
+        close(fd);
+#else
+    FILE *in = fopen(path, "rb");
+    if (in && fseek(in, 0, SEEK_END) == 0)
+    {
+        long size = ftell(in);
+        unsigned char *data = size > 0 ? malloc((size_t)size) : NULL;
+        if (data && fseek(in, 0, SEEK_SET) == 0 && fread(data, 1, (size_t)size, in) == (size_t)size)
+        {
+            file->data = data;
+            file->size = (size_t)size;
+        }
+        else
+        {
+            free(data);
+        }
+    }
+    if (in)
+        fclose(in);
+#endif
+
+    if (!file->data)
+    {
+        free(file);
+        return NULL;
+    }
+    return file;
+}
+
+void symbols_cache_file_close(struct symbol_cache_file *file)
+{
+    if (!file)
+        return;
+
+#if SYMBOLS_HAVE_MMAP
+    if (file->mapped)
+        munmap((void *)file->data, file->size);
+    else
+        free((void *)file->data);
+#else
+    free((void *)file->data);
+#endif
+    free(file);
+}
+
+FILE *symbols_cache_file_create(const char *path, char **temp)
+{
+    size_t length = strlen(path);
+    char *name = malloc(length + 8);
+    if (!name)
+        return NULL;
+    memcpy(name, path, length);
+
+#if SYMBOLS_HAVE_MMAP
+    // A unique name, so concurrent writers of the same file do not collide
+    memcpy(name + length, ".XXXXXX", 8);
+    int fd = mkstemp(name);
+    FILE *out = NULL;
+    if (fd >= 0)
+    {
+        fchmod(fd, 0644);
+        out = fdopen(fd, "wb");
+        if (!out)
+        {
+            close(fd);
+            remove(name);
+        }
+    }
+#else
+    memcpy(name + length, ".tmp", 5);
+    FILE *out = fopen(name, "wb");
+#endif
+
+    if (!out)
+    {
+        free(name);
+        return NULL;
+    }
+    *temp = name;
+    return out;
+}
+
+bool symbols_cache_file_commit(FILE *out, char *temp, const char *path, bool ok)
+{
+    ok = !ferror(out) && ok;
+    ok = fclose(out) == 0 && ok;
+
+#if !SYMBOLS_HAVE_MMAP
+    // rename() does not replace an existing file here
+    if (ok)
+        remove(path);
+#endif
+    ok = ok && rename(temp, path) == 0;
+    if (!ok)
+        remove(temp);
+    free(temp);
+    return ok;
+}
+
+bool symbols_cache_file_write(FILE *out, const void *data, size_t size)
+{
+    static const unsigned char zeros[8];
+    size_t padding = (size_t)(align8(size) - size);
+    return (size == 0 || fwrite(data, 1, size, out) == size) &&
+           (padding == 0 || fwrite(zeros, 1, padding, out) == padding);
+}
+
+// Size every section must have for the counts in 'header'
+static uint64_t section_size(const struct cache_header *header, unsigned section)
+{
+    uint64_t entries = header->entry_count;
+    uint64_t partitioned = header->type_start[SYMBOL_TYPE_PARTITIONS];
+    bool eytzinger = entries > SYMBOL_SEARCH_LINEAR_MAX;
+
+    switch (section)
+    {
+    case SECTION_STRINGS:
+        return header->sections[SECTION_STRINGS].size; // Checked by its records
+    case SECTION_STRING_OFFSETS:
+        return header->string_count * sizeof(uint32_t);
+    case SECTION_STRING_SLOTS:
+        return header->string_slot_count * sizeof(uint32_t);
+    case SECTION_FILES:
+        return header->file_count * sizeof(uint32_t);
+    case SECTION_DESC:
+    case SECTION_TYPES:
+        return entries;
+    case SECTION_NAME_SLOTS:
+        return header->name_slot_count * sizeof(uint32_t);
+    case SECTION_NAME_NEXT:
+    case SECTION_LINE_NEXT:
+    case SECTION_LINES:
+    case SECTION_FILE_IDS:
+    case SECTION_NAME_IDS:
+        return entries * sizeof(uint32_t);
+    case SECTION_LINE_MAP:
+        return (header->parts & SYMBOL_INDEX_LINE_MAP) ? SYMBOL_LINE_MAP_SIZE * sizeof(uint32_t) : 0;
+    case SECTION_FILE_LINE_START:
+        return (header->file_count + 1) * sizeof(uint32_t);
+    case SECTION_FILE_LINE_NUM:
+    case SECTION_FILE_LINE_POS:
+        return header->file_line_count * sizeof(uint32_t);
+    case SECTION_FILE_ENTRY:
+        return header->file_count * sizeof(uint32_t);
+    case SECTION_ADDRESSES:
+        return entries * sizeof(uint16_t);
+    case SECTION_EYTZINGER:
+        return eytzinger ? (entries + 1) * sizeof(uint16_t) : 0;
+    case SECTION_EYTZINGER_RANK:
+        return eytzinger ? (entries + 1) * sizeof(uint32_t) : 0;
+    case SECTION_TYPE_POS:
+        return partitioned * sizeof(uint32_t);
+    case SECTION_TYPE_ADDR:
+        return partitioned * sizeof(uint16_t);
+    case SECTION_SORTED_NAMES:
+        return header->sorted_name_count * sizeof(uint32_t);
+    case SECTION_NAME_TEXT:
+    case SECTION_NAME_TEXT_FOLDED:
+        return header->name_text_size;
+    case SECTION_NAME_OFFSETS:
+        return (header->sorted_name_count + 1) * sizeof(uint32_t);
+    default:
+        return 0;
+    }
+}
+
+// The pool's strings as STRINGS records, and the offset of each one's text
+static unsigned char *pack_strings(const struct symbol_strpool *pool, uint32_t *offsets, size_t *size)
+{
+    size_t total = 0;
+    for (size_t id = 0; id < pool->count; id++)
+        total += (sizeof(uint32_t) + strlen(pool->strings[id]) + 1 + 3) & ~(size_t)3;
+    if (total > UINT32_MAX)
+        return NULL;
+
+    unsigned char *records = calloc(total ? total : 1, 1);
+    if (!records)
+        return NULL;
+
+    size_t at = 0;
+    for (size_t id = 0; id < pool->count; id++)
+    {
+        uint32_t id32 = (uint32_t)id;
+        size_t length = strlen(pool->strings[id]) + 1;
+        memcpy(records + at, &id32, sizeof(id32));
+        memcpy(records + at + sizeof(id32), pool->strings[id], length);
+        offsets[id] = (uint32_t)(at + sizeof(id32));
+        at += (sizeof(uint32_t) + length + 3) & ~(size_t)3;
+    }
+    *size = total;
+    return records;
+}
+
+/// @brief Writes a table to a cache file for symbols_open_cache()
+/// @param table Pointer to a frozen symbol table
+/// @param path File to write (replaced atomically)
+/// @return True if the file was written; false for a table that is not
+///         frozen, which is left as it is
+bool symbols_save_cache(const symbol_table_t *table, const char *path)
+{
+    if (!table || !path || !table->frozen || !table->index ||
+        (table->index->built & CACHE_PARTS) != CACHE_PARTS)
+        return false;
+
+    const struct symbol_index *index = table->index;
+    const struct symbol_strpool *pool = table->strings;
+    const struct symbol_files *files = table->files;
+    size_t count = table->count;
+
+    struct cache_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = CACHE_VERSION;
+    header.byte_order = CACHE_BYTE_ORDER;
+    header.flags = table->line_index_enabled ? CACHE_LINE_INDEX : 0;
+    header.parts = index->built & (CACHE_PARTS | (table->line_index_enabled ? SYMBOL_INDEX_LINE_MAP : 0));
+    header.entry_count = count;
+    header.string_count = pool->count;
+    header.string_bytes = pool->string_bytes;
+    header.string_slot_count = pool->slot_count;
+    header.file_count = files->count;
+    header.file_line_count = index->file_line_start[files->count];
+    header.name_slot_count = index->name_slot_count;
+    header.sorted_name_count = index->sorted_name_count;
+    header.name_text_size = index->name_text_size;
+    header.type_other = index->type_other;
+    memcpy(header.type_start, index->type_start, sizeof(header.type_start));
+
+    // Sections that are not stored as they are in memory
+    uint32_t *string_offsets = malloc((pool->count ? pool->count : 1) * sizeof(uint32_t));
+    uint32_t *file_strings = malloc((files->count ? files->count : 1) * sizeof(uint32_t));
+    uint32_t *sorted_names = malloc((index->sorted_name_count ? index->sorted_name_count : 1) * sizeof(uint32_t));
+    uint8_t *desc = malloc(count ? count : 1);
+    size_t strings_size = 0;
+    unsigned char *strings = string_offsets ? pack_strings(pool, string_offsets, &strings_size) : NULL;
+    bool ok = string_offsets && file_strings && sorted_names && desc && strings;
+
+    if (ok)
+    {
+        for (size_t f = 0; f < files->count; f++)
+            file_strings[f] = symbols_strpool_id(files->paths[f]);
+        for (size_t i = 0; i < index->sorted_name_count; i++)
+            sorted_names[i] = symbols_strpool_id(index->sorted_names[i]);
+        for (size_t i = 0; i < count; i++)
+            desc[i] = table->entries[i].desc;
+    }
+
+    const void *data[SECTION_COUNT] = {
+        [SECTION_STRINGS] = strings,
+        [SECTION_STRING_OFFSETS] = string_offsets,
+        [SECTION_STRING_SLOTS] = pool->slots,
+        [SECTION_FILES] = file_strings,
+        [SECTION_DESC] = desc,
+        [SECTION_NAME_SLOTS] = index->name_slots,
+        [SECTION_NAME_NEXT] = index->name_next,
+        [SECTION_LINE_MAP] = index->line_map,
+        [SECTION_FILE_LINE_START] = index->file_line_start,
+        [SECTION_FILE_LINE_NUM] = index->file_line_num,
+        [SECTION_FILE_LINE_POS] = index->file_line_pos,
+        [SECTION_LINE_NEXT] = index->line_next,
+        [SECTION_FILE_ENTRY] = index->file_entry,
+        [SECTION_ADDRESSES] = index->addresses,
+        [SECTION_TYPES] = index->types,
+        [SECTION_LINES] = index->lines,
+        [SECTION_FILE_IDS] = index->file_ids,
+        [SECTION_NAME_IDS] = index->name_ids,
+        [SECTION_EYTZINGER] = index->eytzinger,
+        [SECTION_EYTZINGER_RANK] = index->eytzinger_rank,
+        [SECTION_TYPE_POS] = index->type_pos,
+        [SECTION_TYPE_ADDR] = index->type_addr,
+        [SECTION_SORTED_NAMES] = sorted_names,
+        [SECTION_NAME_TEXT] = index->name_text,
+        [SECTION_NAME_TEXT_FOLDED] = index->name_text_folded,
+        [SECTION_NAME_OFFSETS] = index->name_offsets,
+    };
+
+    header.sections[SECTION_STRINGS].size = strings_size;
+    uint64_t offset = align8(sizeof(header));
+    for (unsigned s = 0; s < SECTION_COUNT; s++)
+    {
+        header.sections[s].offset = offset;
+        header.sections[s].size = section_size(&header, s);
+        header.sections[s].checksum = ok ? checksum(data[s], (size_t)header.sections[s].size) : 0;
+        offset = align8(offset + header.sections[s].size);
+    }
+    header.file_size = offset;
+    header.checksum = checksum(&header, sizeof(header));
+
+    char *temp = NULL;
+    FILE *out = ok ? symbols_cache_file_create(path, &temp) : NULL;
+    if (out)
+    {
+        ok = symbols_cache_file_write(out, &header, sizeof(header));
+        for (unsigned s = 0; s < SECTION_COUNT && ok; s++)
+            ok = symbols_cache_file_write(out, data[s], (size_t)header.sections[s].size);
+        ok = symbols_cache_file_commit(out, temp, path, ok);
+    }
+    else
+    {
+        ok = false;
+    }
+
+    free(strings);
+    free(string_offsets);
+    free(file_strings);
+    free(sorted_names);
+    free(desc);
+    return ok;
+}
+
+// The header, if the file is a cache this build can use
+static const struct cache_header *check_header(const struct symbol_cache_file *file)
+{
+    if (file->size < sizeof(struct cache_header))
+        return NULL;
+
+    // The mapping is page aligned and a heap copy is malloc aligned, so
+    // the header and the 8-byte aligned sections can be read directly
+    const struct cache_header *header = (const struct cache_header *)file->data;
+    if (memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != CACHE_VERSION || header->byte_order != CACHE_BYTE_ORDER ||
+        header->file_size != file->size)
+        return NULL;
+
+    if ((header->parts & CACHE_PARTS) != CACHE_PARTS ||
+        header->entry_count > UINT32_MAX - 1 || header->string_count > UINT32_MAX - 1 ||
+        header->file_count > header->string_count || header->sorted_name_count > header->string_count ||
+        header->type_start[SYMBOL_TYPE_PARTITIONS] + header->type_other != header->entry_count)
+        return NULL;
+    for (unsigned t = 0; t < SYMBOL_TYPE_PARTITIONS; t++)
+    {
+        if (header->type_start[t] > header->type_start[t + 1])
+            return NULL;
+    }
+
+    // Power-of-two hash sizes, with room for every key
+    uint64_t slots = header->string_slot_count;
+    if ((slots & (slots - 1)) != 0 || (header->string_count > 0 && slots <= header->string_count))
+        return NULL;
+    slots = header->name_slot_count;
+    if (slots == 0 || (slots & (slots - 1)) != 0 || slots <= header->entry_count)
+        return NULL;
+
+    for (unsigned s = 0; s < SECTION_COUNT; s++)
+    {
+        const struct cache_section *section = &header->sections[s];
+        if (section->offset % 8 != 0 || section->offset > file->size ||
+            section->size > file->size - section->offset || section->size != section_size(header, s) ||
+            section->checksum != checksum(file->data + section->offset, (size_t)section->size))
+            return NULL;
+    }
+
+    struct cache_header copy;
+    memcpy(&copy, header, sizeof(copy));
+    copy.checksum = 0;
+    if (checksum(&copy, sizeof(copy)) != header->checksum)
+        return NULL;
+    return header;
+}
+
+static const void *section_data(const struct symbol_cache_file *file, const struct cache_header *header,
+                                 unsigned section)
+{
+    return header->sections[section].size ? file->data + header->sections[section].offset : NULL;
+}
+
+// Point the pool at the STRINGS records and copy its hash set
+static bool open_strings(symbol_table_t *table, const struct symbol_cache_file *file,
+                         const struct cache_header *header)
+{
+    struct symbol_strpool *pool = table->strings;
+    size_t count = (size_t)header->string_count;
+    const char *text = section_data(file, header, SECTION_STRINGS);
+    size_t text_size = (size_t)header->sections[SECTION_STRINGS].size;
+    const uint32_t *offsets = section_data(file, header, SECTION_STRING_OFFSETS);
+    const uint32_t *slots = section_data(file, header, SECTION_STRING_SLOTS);
+
+    // Every string ends within the section if the section ends with a NUL
+    if (count > 0 && (text_size == 0 || text[text_size - 1] != '\0'))
+        return false;
+
+    pool->strings = malloc((count ? count : 1) * sizeof(*pool->strings));
+    pool->slots = malloc((header->string_slot_count ? header->string_slot_count : 1) * sizeof(uint32_t));
+    if (!pool->strings || !pool->slots)
+        return false;
+    pool->capacity = count;
+    pool->slot_count = (size_t)header->string_slot_count;
+
+    for (size_t id = 0; id < count; id++)
+    {
+        uint32_t offset = offsets[id];
+        if (offset < sizeof(uint32_t) || offset % sizeof(uint32_t) != 0 || offset >= text_size)
+            return false;
+        pool->strings[id] = text + offset;
+        if (symbols_strpool_id(pool->strings[id]) != id)
+            return false;
+    }
+    // Lookups probe until an empty slot, so at most 'count' may be used
+    size_t used = 0;
+    for (size_t i = 0; i < pool->slot_count; i++)
+    {
+        if (slots[i] > count)
+            return false;
+        used += slots[i] != 0;
+        pool->slots[i] = slots[i];
+    }
+    if (used > count)
+        return false;
+
+    pool->count = count;
+    pool->string_bytes = (size_t)header->string_bytes;
+    return true;
+}
+
+// Register the files in file id order and rebuild the entries from the
+// packed view
+static bool open_entries(symbol_table_t *table, const struct symbol_cache_file *file,
+                         const struct cache_header *header)
+{
+    struct symbol_files *files = table->files;
+    const char **strings = table->strings->strings;
+    size_t string_count = table->strings->count;
+    const uint32_t *file_strings = section_data(file, header, SECTION_FILES);
+
+    if (!symbols_files_reserve(files, string_count))
+        return false;
+    for (size_t f = 0; f < header->file_count; f++)
+    {
+        if (file_strings[f] >= string_count || symbols_files_add(files, strings[file_strings[f]]) != f)
+            return false;
+    }
+
+    size_t count = (size_t)header->entry_count;
+    const uint16_t *addresses = section_data(file, header, SECTION_ADDRESSES);
+    const uint8_t *types = section_data(file, header, SECTION_TYPES);
+    const int32_t *lines = section_data(file, header, SECTION_LINES);
+    const uint32_t *file_ids = section_data(file, header, SECTION_FILE_IDS);
+    const uint32_t *name_ids = section_data(file, header, SECTION_NAME_IDS);
+    const uint8_t *desc = section_data(file, header, SECTION_DESC);
+
+    symbol_entry_t *entries = malloc((count ? count : 1) * sizeof(symbol_entry_t));
+    if (!entries)
+        return false;
+    free(table->entries);
+    table->entries = entries;
+    table->capacity = count;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (file_ids[i] > files->count || name_ids[i] > string_count)
+            return false;
+        entries[i].filename = file_ids[i] ? files->paths[file_ids[i] - 1] : NULL;
+        entries[i].name = name_ids[i] ? strings[name_ids[i] - 1] : NULL;
+        entries[i].line = lines[i];
+        entries[i].address = addresses[i];
+        entries[i].type = (symbol_type_t)types[i];
+        entries[i].desc = desc[i];
+        entries[i].owns_strings = false;
+    }
+    table->count = count;
+    return true;
+}
+
+// Positions + 1 (0 = none) must name an entry
+static bool check_positions(const uint32_t *values, size_t n, size_t count)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        if (values[i] > count)
+            return false;
+    }
+    return true;
+}
+
+// Check every stored position, offset and chain of the index parts, so
+// that no query on a damaged file reads outside the table or loops
+static bool check_index(const struct symbol_index *index, size_t count, size_t file_count,
+                        size_t file_line_count)
+{
+    // Name hash: probes stop at an empty slot, and chains only move forward
+    size_t used = 0;
+    for (size_t i = 0; i < index->name_slot_count; i++)
+    {
+        if (index->name_slots[i] > count)
+            return false;
+        used += index->name_slots[i] != 0;
+    }
+    if (used > count)
+        return false;
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t next = index->name_next[i];
+        uint32_t line_next = index->line_next[i];
+        if ((next != 0 && (next <= i + 1 || next > count)) ||
+            (line_next != 0 && (line_next <= i + 1 || line_next > count)))
+            return false;
+    }
+
+    if (index->line_map && !check_positions(index->line_map, SYMBOL_LINE_MAP_SIZE, count))
+        return false;
+    if (!check_positions(index->file_entry, file_count, count))
+        return false;
+
+    for (size_t f = 0; f < file_count; f++)
+    {
+        if (index->file_line_start[f] > index->file_line_start[f + 1])
+            return false;
+    }
+    if (index->file_line_start[file_count] > file_line_count)
+        return false;
+    for (size_t i = 0; i < file_line_count; i++)
+    {
+        if (index->file_line_pos[i] >= count)
+            return false;
+    }
+
+    if (index->eytzinger_rank)
+    {
+        for (size_t k = 1; k <= count; k++)
+        {
+            if (index->eytzinger_rank[k] >= count)
+                return false;
+        }
+    }
+
+    for (size_t i = 0; i < index->type_start[SYMBOL_TYPE_PARTITIONS]; i++)
+    {
+        if (index->type_pos[i] >= count)
+            return false;
+    }
+
+    // Every name is non-empty in the buffer and ends in a NUL in both texts
+    size_t names = index->sorted_name_count;
+    if (index->name_offsets[names] != index->name_text_size)
+        return false;
+    for (size_t i = 0; i < names; i++)
+    {
+        uint32_t end = index->name_offsets[i + 1];
+        if (index->name_offsets[i] >= end || index->name_text[end - 1] != '\0' ||
+            index->name_text_folded[end - 1] != '\0')
+            return false;
+    }
+    return true;
+}
+
+// Point the index parts at their sections; only the sorted name pointers
+// are rebuilt from pool ids
+static bool open_index(symbol_table_t *table, const struct symbol_cache_file *file,
+                       const struct cache_header *header)
+{
+    struct symbol_index *index = calloc(1, sizeof(*index));
+    if (!index)
+        return false;
+    table->index = index;
+    index->arena = symbols_arena_create();
+    if (!index->arena)
+        return false;
+
+    // The file is read-only, and so is a frozen table's index
+    index->name_slots = (uint32_t *)section_data(file, header, SECTION_NAME_SLOTS);
+    index->name_slot_count = (size_t)header->name_slot_count;
+    index->name_next = (uint32_t *)section_data(file, header, SECTION_NAME_NEXT);
+    index->line_map = (uint32_t *)section_data(file, header, SECTION_LINE_MAP);
+    index->file_line_start = (uint32_t *)section_data(file, header, SECTION_FILE_LINE_START);
+    index->file_line_num = (int32_t *)section_data(file, header, SECTION_FILE_LINE_NUM);
+    index->file_line_pos = (uint32_t *)section_data(file, header, SECTION_FILE_LINE_POS);
+    index->line_next = (uint32_t *)section_data(file, header, SECTION_LINE_NEXT);
+    index->file_entry = (uint32_t *)section_data(file, header, SECTION_FILE_ENTRY);
+    index->addresses = (uint16_t *)section_data(file, header, SECTION_ADDRESSES);
+    index->types = (uint8_t *)section_data(file, header, SECTION_TYPES);
+    index->lines = (int32_t *)section_data(file, header, SECTION_LINES);
+    index->file_ids = (uint32_t *)section_data(file, header, SECTION_FILE_IDS);
+    index->name_ids = (uint32_t *)section_data(file, header, SECTION_NAME_IDS);
+    index->eytzinger = (uint16_t *)section_data(file, header, SECTION_EYTZINGER);
+    index->eytzinger_rank = (uint32_t *)section_data(file, header, SECTION_EYTZINGER_RANK);
+    memcpy(index->type_start, header->type_start, sizeof(index->type_start));
+    index->type_pos = (uint32_t *)section_data(file, header, SECTION_TYPE_POS);
+    index->type_addr = (uint16_t *)section_data(file, header, SECTION_TYPE_ADDR);
+    index->type_other = (size_t)header->type_other;
+    index->name_text = (char *)section_data(file, header, SECTION_NAME_TEXT);
+    index->name_text_folded = (char *)section_data(file, header, SECTION_NAME_TEXT_FOLDED);
+    index->name_offsets = (uint32_t *)section_data(file, header, SECTION_NAME_OFFSETS);
+    index->name_text_size = (size_t)header->name_text_size;
+
+    size_t names = (size_t)header->sorted_name_count;
+    const uint32_t *name_strings = section_data(file, header, SECTION_SORTED_NAMES);
+    index->sorted_names = symbols_arena_alloc(index->arena, (names ? names : 1) * sizeof(const char *),
+                                              sizeof(const char *));
+    if (!index->sorted_names)
+        return false;
+    for (size_t i = 0; i < names; i++)
+    {
+        if (name_strings[i] >= table->strings->count)
+            return false;
+        index->sorted_names[i] = table->strings->strings[name_strings[i]];
+    }
+    index->sorted_name_count = names;
+
+    index->built = header->parts;
+    return check_index(index, table->count, (size_t)header->file_count, (size_t)header->file_line_count);
+}
+
+/// @brief Opens a cache file written by symbols_save_cache() as a frozen table
+/// @param path Cache file
+/// @return The table, or NULL if the file is missing, foreign or malformed
+///
+/// The header and section sizes are checked, and so is every string and
+/// file reference while the entries are rebuilt and every position, offset
+/// and chain stored in the index sections.  Values that cannot make a query
+/// read out of bounds (addresses, lines) are taken as written.
+symbol_table_t *symbols_open_cache(const char *path)
+{
+    if (!path)
+        return NULL;
+
+    uint64_t load_start = symbols_profile_start();
+    struct symbol_cache_file *file = symbols_cache_file_open(path);
+    if (!file)
+        return NULL;
+
+    const struct cache_header *header = check_header(file);
+    symbol_table_t *table = header ? symbols_create() : NULL;
+    if (!table)
+    {
+        symbols_cache_file_close(file);
+        return NULL;
+    }
+    table->cache = file;
+
+    if (!open_strings(table, file, header) || !open_entries(table, file, header) ||
+        !open_index(table, file, header))
+    {
+        symbols_free(table);
+        return NULL;
+    }
+
+    table->line_index_enabled = (header->flags & CACHE_LINE_INDEX) != 0;
+    table->frozen = true;
+    symbols_profile_end_load(path, load_start, table->count);
+    return table;
+}
+
+// FNV-1a, 64-bit
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= p[i];
+        hash *= 1099511628211u;
+    }
+    return hash;
+}
+
+static uint64_t hash_u64(uint64_t hash, uint64_t value)
+{
+    unsigned char bytes[8];
+    for (int i = 0; i < 8; i++)
+        bytes[i] = (unsigned char)(value >> (8 * i));
+    return hash_bytes(hash, bytes, sizeof(bytes));
+}
+
+// Add a file's identity (path, size, modification time and optionally its
+// contents) to 'hash'; false if the file cannot be read
+static bool hash_source(uint64_t *hash, const char *path, unsigned flags)
+{
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return false;
+
+    uint64_t mtime_ns = 0;
+#if defined(__linux__)
+    mtime_ns = (uint64_t)st.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+    mtime_ns = (uint64_t)st.st_mtimespec.tv_nsec;
+#endif
+    *hash = hash_bytes(*hash, path, strlen(path) + 1);
+    *hash = hash_u64(*hash, (uint64_t)st.st_size);
+    *hash = hash_u64(*hash, (uint64_t)st.st_mtime);
+    *hash = hash_u64(*hash, mtime_ns);
+
+    if (flags & SYMBOL_CACHE_HASH_CONTENTS)
+    {
+        FILE *in = fopen(path, "rb");
+        if (!in)
+            return false;
+        unsigned char buffer[65536];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+            *hash = hash_bytes(*hash, buffer, n);
+        bool ok = !ferror(in);
+        fclose(in);
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+// Load one symbol file with the loader for its extension
+static bool load_source(symbol_table_t *table, const char *path)
+{
+    const char *dot = strrchr(path, '.');
+    const char *slash = strrchr(path, '/');
+    if (!dot || (slash && dot < slash))
+        return false;
+
+    if (strcmp(dot, ".s") == 0)
+        return symbols_load_stabs(table, path);
+    if (strcmp(dot, ".out") == 0)
+        return symbols_load_aout(table, path);
+    if (strcmp(dot, ".map") == 0 || strcmp(dot, ".srcmap") == 0)
+        return symbols_load_map(table, path);
+    return false;
+}
+
+/// @brief Loads symbol files into an empty table, reusing a cached copy when the files are unchanged
+/// @param table Pointer to an empty, unfrozen symbol table
+/// @param paths Symbol files, loaded in this order
+/// @param count Number of paths
+/// @param cache_dir Existing directory for the cache files
+/// @param flags SYMBOL_CACHE_* flags
+/// @return True if the table was loaded (and frozen); on false it is left
+///         empty and unfrozen
+///
+/// A cache file is only used if it passes every check of
+/// symbols_open_cache(), checksums included; a damaged one costs a parse
+/// and is replaced.  Cache files are never removed: a changed input gets a
+/// new file name, and the old file stays until the directory is cleaned.
+bool symbols_load_cached(symbol_table_t *table, const char *const *paths, size_t count,
+                         const char *cache_dir, unsigned flags)
+{
+    if (!table || table->frozen || table->count > 0 || (!paths && count > 0) || !cache_dir)
+        return false;
+
+    uint64_t key = 14695981039346656037u;
+    key = hash_u64(key, CACHE_VERSION);
+    key = hash_u64(key, table->line_index_enabled);
+    key = hash_u64(key, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!paths[i] || !hash_source(&key, paths[i], flags))
+            return false;
+    }
+
+    size_t length = strlen(cache_dir);
+    char *cache_path = malloc(length + 32);
+    if (!cache_path)
+        return false;
+    snprintf(cache_path, length + 32, "%s/%016llx.symcache", cache_dir, (unsigned long long)key);
+
+    // Either way the contents are built in a table of their own and taken
+    // over on success (the empty ones go with the shell), so a failed load
+    // leaves 'table' as it was
+    symbol_table_t *loaded = symbols_open_cache(cache_path);
+    bool ok = loaded != NULL;
+    if (!ok)
+    {
+        loaded = symbols_create();
+        ok = loaded && symbols_set_line_index(loaded, table->line_index_enabled);
+        for (size_t i = 0; i < count && ok; i++)
+            ok = load_source(loaded, paths[i]);
+        ok = ok && symbols_freeze(loaded);
+
+        // A cache that cannot be written only costs the next run a parse
+        if (ok)
+            symbols_save_cache(loaded, cache_path);
+    }
+
+    if (ok)
+    {
+        symbol_table_t empty = *table;
+        *table = *loaded;
+        *loaded = empty;
+    }
+    symbols_free(loaded);
+    free(cache_path);
+    return ok;
+}
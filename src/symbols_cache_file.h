@@ -0,0 +1,38 @@
+#ifndef SYMBOLS_CACHE_FILE_H
+#define SYMBOLS_CACHE_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Internal: a cache file held in memory while a table (or debug info)
+// opened from it is alive.  The contents are mapped read-only where mmap()
+// is available and read into a heap copy elsewhere; either way the owner
+// uses them in place.
+
+struct symbol_cache_file
+{
+    const unsigned char *data; // File contents
+    size_t size;
+    bool mapped;               // 'data' is an mmap() view, not a heap copy
+};
+
+// Map (or read) a whole file; NULL if it cannot be opened or is empty
+struct symbol_cache_file *symbols_cache_file_open(const char *path);
+
+// Release the file's memory
+void symbols_cache_file_close(struct symbol_cache_file *file);
+
+// Start writing 'path' under a temporary name next to it.  Returns the
+// stream and the temporary name (owned by the caller), or NULL.
+FILE *symbols_cache_file_create(const char *path, char **temp);
+
+// Close a stream from symbols_cache_file_create() and, if 'ok' and every
+// write succeeded, rename the file to 'path'; otherwise remove it.  Frees
+// 'temp'.
+bool symbols_cache_file_commit(FILE *out, char *temp, const char *path, bool ok);
+
+// Write 'size' bytes followed by zeros up to a multiple of 8
+bool symbols_cache_file_write(FILE *out, const void *data, size_t size);
+
+#endif /* SYMBOLS_CACHE_FILE_H */
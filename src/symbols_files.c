@@ -0,0 +1,178 @@
+#include "symbols_files.h"
+#include "symbols_index.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct symbol_files *symbols_files_create(void)
+{
+    return calloc(1, sizeof(struct symbol_files));
+}
+
+void symbols_files_free(struct symbol_files *files)
+{
+    if (!files)
+        return;
+
+    // Paths belong to the string pool
+    free(files->paths);
+    free(files->basenames);
+    free(files->next_same_base);
+    free(files->by_string);
+    free(files->base_slots);
+    free(files);
+}
+
+static const char *path_basename(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// Find the slot for 'basename', or the empty slot where it belongs
+static uint32_t *find_base_slot(const struct symbol_files *files, const char *basename)
+{
+    size_t mask = files->base_slot_count - 1;
+    size_t i = symbols_index_hash_string(basename) & mask;
+
+    while (files->base_slots[i] != 0 &&
+           strcmp(files->basenames[files->base_slots[i] - 1], basename) != 0)
+        i = (i + 1) & mask;
+
+    return &files->base_slots[i];
+}
+
+static bool grow_base_slots(struct symbol_files *files, size_t min_slots)
+{
+    size_t slot_count = files->base_slot_count ? files->base_slot_count : 64;
+    while (slot_count < min_slots)
+        slot_count *= 2;
+    if (slot_count == files->base_slot_count)
+        return true;
+
+    uint32_t *slots = calloc(slot_count, sizeof(uint32_t));
+    if (!slots)
+        return false;
+
+    free(files->base_slots);
+    files->base_slots = slots;
+    files->base_slot_count = slot_count;
+
+    // Re-insert the chain heads; the chains themselves are unchanged
+    for (size_t id = 0; id < files->count; id++)
+    {
+        uint32_t *slot = find_base_slot(files, files->basenames[id]);
+        if (*slot == 0)
+            *slot = (uint32_t)id + 1;
+    }
+    return true;
+}
+
+// Make room for one more file in the per-file arrays and the basename hash
+static bool grow_files(struct symbol_files *files)
+{
+    if (files->count == files->capacity)
+    {
+        size_t capacity = files->capacity ? files->capacity * 2 : 16;
+
+        const char **paths = realloc(files->paths, capacity * sizeof(*paths));
+        if (paths)
+            files->paths = paths;
+        const char **basenames = realloc(files->basenames, capacity * sizeof(*basenames));
+        if (basenames)
+            files->basenames = basenames;
+        uint32_t *next = realloc(files->next_same_base, capacity * sizeof(*next));
+        if (next)
+            files->next_same_base = next;
+        if (!paths || !basenames || !next)
+            return false;
+        files->capacity = capacity;
+    }
+
+    return grow_base_slots(files, (files->count + 1) * 2);
+}
+
+bool symbols_files_reserve(struct symbol_files *files, size_t string_count)
+{
+    if (!files)
+        return false;
+
+    if (string_count > files->string_capacity)
+    {
+        size_t capacity = files->string_capacity ? files->string_capacity : 64;
+        while (capacity < string_count)
+            capacity *= 2;
+
+        uint32_t *by_string = realloc(files->by_string, capacity * sizeof(uint32_t));
+        if (!by_string)
+            return false;
+        memset(by_string + files->string_capacity, 0,
+               (capacity - files->string_capacity) * sizeof(uint32_t));
+        files->by_string = by_string;
+        files->string_capacity = capacity;
+    }
+    return true;
+}
+
+uint32_t symbols_files_add(struct symbol_files *files, const char *pooled)
+{
+    uint32_t id = symbols_files_id(files, pooled);
+    if (id != SYMBOL_FILE_NONE)
+        return id;
+    if (!grow_files(files))
+        return SYMBOL_FILE_NONE;
+
+    id = (uint32_t)files->count++;
+    files->paths[id] = pooled;
+    files->basenames[id] = path_basename(pooled);
+    files->next_same_base[id] = 0;
+    files->by_string[symbols_strpool_id(pooled)] = id + 1;
+
+    // Append to the end of the basename chain, so chains are in file id order
+    uint32_t *slot = find_base_slot(files, files->basenames[id]);
+    if (*slot == 0)
+    {
+        *slot = id + 1;
+    }
+    else
+    {
+        uint32_t last = *slot - 1;
+        while (files->next_same_base[last] != 0)
+            last = files->next_same_base[last] - 1;
+        files->next_same_base[last] = id + 1;
+    }
+    return id;
+}
+
+void symbols_files_truncate(struct symbol_files *files, size_t count)
+{
+    if (!files || count >= files->count)
+        return;
+
+    for (size_t id = count; id < files->count; id++)
+        files->by_string[symbols_strpool_id(files->paths[id])] = 0;
+    files->count = count;
+
+    // Chains are in file id order, so they just end earlier; the hash is
+    // refilled because open addressing cannot simply clear a slot
+    for (size_t id = 0; id < count; id++)
+    {
+        if (files->next_same_base[id] > count)
+            files->next_same_base[id] = 0;
+    }
+    memset(files->base_slots, 0, files->base_slot_count * sizeof(uint32_t));
+    for (size_t id = 0; id < count; id++)
+    {
+        uint32_t *slot = find_base_slot(files, files->basenames[id]);
+        if (*slot == 0)
+            *slot = (uint32_t)id + 1;
+    }
+}
+
+uint32_t symbols_files_find_basename(const struct symbol_files *files, const char *basename)
+{
+    if (!files || !basename || files->count == 0)
+        return SYMBOL_FILE_NONE;
+
+    uint32_t slot = *find_base_slot(files, basename);
+    return slot ? slot - 1 : SYMBOL_FILE_NONE;
+}
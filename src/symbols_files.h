@@ -0,0 +1,58 @@
+#ifndef SYMBOLS_FILES_H
+#define SYMBOLS_FILES_H
+
+#include "symbols_strpool.h"
+
+// Internal: registry of the source files referenced by a table's entries.
+//
+// Every distinct filename gets a dense file id in the order it was first
+// added.  Paths are pooled strings, so the full path map is indexed by the
+// pool id; basenames point into the pooled path and have their own hash,
+// with files that share a basename chained together.
+
+// File id returned when a string is not a registered file
+#define SYMBOL_FILE_NONE UINT32_MAX
+
+struct symbol_files
+{
+    const char **paths;       // Pooled path by file id
+    const char **basenames;   // Basename by file id (points into the path)
+    uint32_t *next_same_base; // File id + 1 of the next file with the same basename (0 = end)
+    size_t count;             // Number of registered files
+    size_t capacity;          // Capacity of the arrays above (grows with the files)
+    uint32_t *by_string;      // File id + 1 by pool id (0 = not a file)
+    size_t string_capacity;   // Capacity of 'by_string'
+    uint32_t *base_slots;     // Basename hash: file id + 1 of the first file (0 = empty)
+    size_t base_slot_count;   // Power of two, at least twice the file count
+};
+
+struct symbol_files *symbols_files_create(void);
+void symbols_files_free(struct symbol_files *files);
+
+// Make room in the pool id map for a pool with 'string_count' strings.
+// Only that map tracks the pool; the per-file arrays grow with the files.
+bool symbols_files_reserve(struct symbol_files *files, size_t string_count);
+
+// Register a pooled path (no-op if already known) and return its file id,
+// or SYMBOL_FILE_NONE if the registry could not grow.  The pool id map must
+// have been reserved with symbols_files_reserve().
+uint32_t symbols_files_add(struct symbol_files *files, const char *pooled);
+
+// Unregister every file with an id of 'count' or more, undoing the
+// symbols_files_add() calls of an operation that failed part way
+void symbols_files_truncate(struct symbol_files *files, size_t count);
+
+// First file with the given basename, or SYMBOL_FILE_NONE.  Further files
+// with the same basename follow through next_same_base.
+uint32_t symbols_files_find_basename(const struct symbol_files *files, const char *basename);
+
+// File id of a pooled path, or SYMBOL_FILE_NONE
+static inline uint32_t symbols_files_id(const struct symbol_files *files, const char *pooled)
+{
+    uint32_t id = symbols_strpool_id(pooled);
+    if (id >= files->string_capacity || files->by_string[id] == 0)
+        return SYMBOL_FILE_NONE;
+    return files->by_string[id] - 1;
+}
+
+#endif /* SYMBOLS_FILES_H */
@@ -0,0 +1,92 @@
+#include "symbols.h"
+#include "symbols_atomic.h"
+#include <stdlib.h>
+
+// Readers announce themselves in one of two counters, chosen by the parity
+// of the epoch.  A writer swaps the table pointer, moves the epoch on and
+// waits until the counter of the previous epoch drains: every reader that
+// could still see the old table entered under that epoch.  Readers that
+// race with the epoch change back out and retry under the new one, so a
+// stream of readers cannot starve the writer.
+struct symbols_handle
+{
+    void *volatile current;      // symbol_table_t *, frozen
+    volatile size_t epoch;
+    volatile size_t readers[2];  // Active readers by epoch parity
+    volatile size_t writer_lock; // Serializes publishers
+};
+
+symbols_handle_t *symbols_handle_create(symbol_table_t *table)
+{
+    if (table && !symbols_freeze(table))
+        return NULL;
+
+    symbols_handle_t *handle = calloc(1, sizeof(symbols_handle_t));
+    if (!handle)
+        return NULL;
+
+    handle->current = table;
+    return handle;
+}
+
+void symbols_handle_free(symbols_handle_t *handle)
+{
+    if (!handle)
+        return;
+
+    symbols_free((symbol_table_t *)handle->current);
+    free(handle);
+}
+
+const symbol_table_t *symbols_handle_read_begin(symbols_handle_t *handle, symbols_reader_t *reader)
+{
+    if (!handle || !reader)
+        return NULL;
+
+    for (;;)
+    {
+        size_t epoch = symbols_atomic_load(&handle->epoch);
+        symbols_atomic_add(&handle->readers[epoch & 1], 1);
+        if (symbols_atomic_load(&handle->epoch) == epoch)
+        {
+            reader->handle = handle;
+            reader->slot = (unsigned)(epoch & 1);
+            reader->table = symbols_atomic_load_ptr(&handle->current);
+            return reader->table;
+        }
+        symbols_atomic_sub(&handle->readers[epoch & 1], 1);
+    }
+}
+
+void symbols_handle_read_end(symbols_reader_t *reader)
+{
+    if (!reader || !reader->handle)
+        return;
+
+    symbols_atomic_sub(&reader->handle->readers[reader->slot], 1);
+    reader->handle = NULL;
+    reader->table = NULL;
+}
+
+bool symbols_handle_publish(symbols_handle_t *handle, symbol_table_t *table)
+{
+    if (!handle)
+        return false;
+    if (table && !symbols_freeze(table))
+        return false;
+
+    while (!symbols_atomic_try_lock(&handle->writer_lock))
+        symbols_atomic_yield();
+
+    symbol_table_t *old = symbols_atomic_exchange_ptr(&handle->current, table);
+    size_t epoch = symbols_atomic_load(&handle->epoch);
+    symbols_atomic_store(&handle->epoch, epoch + 1);
+    while (symbols_atomic_load(&handle->readers[epoch & 1]) != 0)
+        symbols_atomic_yield();
+
+    symbols_atomic_unlock(&handle->writer_lock);
+
+    // No reader can reach the old table any more
+    symbols_free(old);
+    return true;
+}
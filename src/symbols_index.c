@@ -0,0 +1,559 @@
+#include "symbols_index.h"
+#include "symbols_strpool.h"
+#include "symbols_files.h"
+#include "symbols_arena.h"
+#include "symbols_search.h"
+#include "symbols_cache.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+// FNV-1a hash of a NUL terminated string
+uint32_t symbols_index_hash_string(const char *str)
+{
+    uint32_t hash = 2166136261u;
+    while (*str)
+    {
+        hash ^= (unsigned char)*str++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Build the name hash.  Names are interned, so they are hashed by pool id
+// and compared by pointer.  Entries are visited from last to first so that
+// each chain ends up in table order, with the first entry at the head.
+static bool build_names(const symbol_table_t *table, struct symbol_index *index)
+{
+    size_t slot_count = 64;
+    while (slot_count < table->count * 2)
+        slot_count *= 2;
+
+    index->name_slots = symbols_arena_calloc(index->arena, slot_count, sizeof(uint32_t));
+    index->name_next = symbols_arena_calloc(index->arena, table->count ? table->count : 1, sizeof(uint32_t));
+    if (!index->name_slots || !index->name_next)
+        return false;
+    index->name_slot_count = slot_count;
+
+    size_t mask = slot_count - 1;
+    for (size_t i = table->count; i-- > 0;)
+    {
+        const char *name = table->entries[i].name;
+        if (!name)
+            continue;
+
+        size_t slot = symbols_index_hash_id(symbols_strpool_id(name)) & mask;
+        while (index->name_slots[slot] != 0 &&
+               table->entries[index->name_slots[slot] - 1].name != name)
+            slot = (slot + 1) & mask;
+
+        index->name_next[i] = index->name_slots[slot];
+        index->name_slots[slot] = (uint32_t)i + 1;
+    }
+
+    index->built |= SYMBOL_INDEX_NAMES;
+    return true;
+}
+
+// Fill the direct-mapped line index.  This precomputes the answer of the
+// floor scan in find_source_entry() for every address, using the same
+// rules on the address-sorted entries:
+//   - the floor is the LINE entry with the highest address <= query, and
+//     among entries at that address the first one with the highest line;
+//   - addresses below the first LINE entry are unmapped;
+//   - past the last LINE entry, at most 32 addresses are still mapped.
+void symbols_index_fill_line_map(const symbol_table_t *table, uint32_t *line_map)
+{
+    size_t floor = SIZE_MAX; // Position of the floor of the current group
+    for (size_t i = 0; i < table->count; i++)
+    {
+        const symbol_entry_t *entry = &table->entries[i];
+        if (entry->type != SYMBOL_TYPE_LINE)
+            continue;
+
+        if (floor != SIZE_MAX && entry->address == table->entries[floor].address)
+        {
+            if (entry->line > table->entries[floor].line)
+                floor = i;
+            continue;
+        }
+
+        // A new address starts: the previous group covers up to here
+        if (floor != SIZE_MAX)
+        {
+            for (uint32_t a = table->entries[floor].address; a < entry->address; a++)
+                line_map[a] = (uint32_t)floor + 1;
+        }
+        floor = i;
+    }
+
+    if (floor != SIZE_MAX)
+    {
+        uint32_t start = table->entries[floor].address;
+        uint32_t end = start + 32;
+        if (end >= SYMBOL_LINE_MAP_SIZE)
+            end = SYMBOL_LINE_MAP_SIZE - 1;
+        for (uint32_t a = start; a <= end; a++)
+            line_map[a] = (uint32_t)floor + 1;
+    }
+}
+
+static bool build_line_map(const symbol_table_t *table, struct symbol_index *index)
+{
+    index->line_map = symbols_arena_calloc(index->arena, SYMBOL_LINE_MAP_SIZE, sizeof(uint32_t));
+    if (!index->line_map)
+        return false;
+
+    symbols_index_fill_line_map(table, index->line_map);
+    index->built |= SYMBOL_INDEX_LINE_MAP;
+    return true;
+}
+
+typedef struct
+{
+    int32_t line;
+    uint32_t position;
+} line_ref_t;
+
+static int compare_line_refs(const void *a, const void *b)
+{
+    const line_ref_t *ref_a = (const line_ref_t *)a;
+    const line_ref_t *ref_b = (const line_ref_t *)b;
+    if (ref_a->line != ref_b->line)
+        return ref_a->line < ref_b->line ? -1 : 1;
+    return (ref_a->position > ref_b->position) - (ref_a->position < ref_b->position);
+}
+
+// Build the per-file line tables: bucket the LINE entries by file id
+// (counting sort), then sort each file's bucket by line.
+static bool build_file_lines(const symbol_table_t *table, struct symbol_index *index)
+{
+    size_t file_count = table->files->count;
+
+    index->file_line_start = symbols_arena_calloc(index->arena, file_count + 1, sizeof(uint32_t));
+    if (!index->file_line_start)
+        return false;
+
+    size_t total = 0;
+    for (size_t i = 0; i < table->count; i++)
+    {
+        const symbol_entry_t *entry = &table->entries[i];
+        if (entry->type == SYMBOL_TYPE_LINE && entry->filename)
+        {
+            index->file_line_start[symbols_files_id(table->files, entry->filename) + 1]++;
+            total++;
+        }
+    }
+    for (size_t f = 0; f < file_count; f++)
+        index->file_line_start[f + 1] += index->file_line_start[f];
+
+    index->file_line_num = symbols_arena_alloc(index->arena, (total ? total : 1) * sizeof(int32_t), sizeof(int32_t));
+    index->file_line_pos = symbols_arena_alloc(index->arena, (total ? total : 1) * sizeof(uint32_t), sizeof(uint32_t));
+    uint32_t *cursor = malloc((file_count + 1) * sizeof(uint32_t));
+    line_ref_t *refs = malloc((total ? total : 1) * sizeof(line_ref_t));
+    if (!index->file_line_num || !index->file_line_pos || !cursor || !refs)
+    {
+        free(cursor);
+        free(refs);
+        return false;
+    }
+
+    memcpy(cursor, index->file_line_start, (file_count + 1) * sizeof(uint32_t));
+    for (size_t i = 0; i < table->count; i++)
+    {
+        const symbol_entry_t *entry = &table->entries[i];
+        if (entry->type == SYMBOL_TYPE_LINE && entry->filename)
+        {
+            line_ref_t *ref = &refs[cursor[symbols_files_id(table->files, entry->filename)]++];
+            ref->line = entry->line;
+            ref->position = (uint32_t)i;
+        }
+    }
+
+    for (size_t f = 0; f < file_count; f++)
+    {
+        uint32_t begin = index->file_line_start[f];
+        uint32_t end = index->file_line_start[f + 1];
+        if (end - begin > 1)
+            qsort(refs + begin, end - begin, sizeof(line_ref_t), compare_line_refs);
+    }
+
+    for (size_t i = 0; i < total; i++)
+    {
+        index->file_line_num[i] = refs[i].line;
+        index->file_line_pos[i] = refs[i].position;
+    }
+
+    free(cursor);
+    free(refs);
+    index->built |= SYMBOL_INDEX_FILE_LINES;
+    return true;
+}
+
+// Build the successor table with one backward sweep over the sorted
+// entries.  'first_above' holds, per file, the first position of that
+// file's LINE entries at the lowest address seen so far.  Entries that
+// share an address are handled as a group, so that they do not become
+// each other's successors.
+static bool build_line_next(const symbol_table_t *table, struct symbol_index *index)
+{
+    // Files are keyed by file id + 1, with 0 for LINE entries without a file
+    size_t file_count = table->files->count + 1;
+
+    index->line_next = symbols_arena_calloc(index->arena, table->count ? table->count : 1, sizeof(uint32_t));
+    uint32_t *first_above = calloc(file_count, sizeof(uint32_t));
+    if (!index->line_next || !first_above)
+    {
+        free(first_above);
+        return false;
+    }
+
+    size_t group_end = table->count;
+    while (group_end > 0)
+    {
+        uint16_t address = table->entries[group_end - 1].address;
+        size_t group_start = group_end - 1;
+        while (group_start > 0 && table->entries[group_start - 1].address == address)
+            group_start--;
+
+        for (size_t i = group_start; i < group_end; i++)
+        {
+            const symbol_entry_t *entry = &table->entries[i];
+            if (entry->type == SYMBOL_TYPE_LINE)
+            {
+                size_t file = entry->filename ? symbols_files_id(table->files, entry->filename) + 1 : 0;
+                index->line_next[i] = first_above[file];
+            }
+        }
+        for (size_t i = group_end; i-- > group_start;)
+        {
+            const symbol_entry_t *entry = &table->entries[i];
+            if (entry->type == SYMBOL_TYPE_LINE)
+            {
+                size_t file = entry->filename ? symbols_files_id(table->files, entry->filename) + 1 : 0;
+                first_above[file] = (uint32_t)i + 1;
+            }
+        }
+
+        group_end = group_start;
+    }
+
+    free(first_above);
+    index->built |= SYMBOL_INDEX_LINE_NEXT;
+    return true;
+}
+
+// Build the packed structure-of-arrays view of the entries
+static bool build_packed(const symbol_table_t *table, struct symbol_index *index)
+{
+    size_t count = table->count ? table->count : 1;
+
+    index->addresses = symbols_arena_alloc(index->arena, count * sizeof(uint16_t), sizeof(uint16_t));
+    index->types = symbols_arena_alloc(index->arena, count * sizeof(uint8_t), sizeof(uint8_t));
+    index->lines = symbols_arena_alloc(index->arena, count * sizeof(int32_t), sizeof(int32_t));
+    index->file_ids = symbols_arena_alloc(index->arena, count * sizeof(uint32_t), sizeof(uint32_t));
+    index->name_ids = symbols_arena_alloc(index->arena, count * sizeof(uint32_t), sizeof(uint32_t));
+    if (!index->addresses || !index->types || !index->lines || !index->file_ids || !index->name_ids)
+        return false;
+
+    for (size_t i = 0; i < table->count; i++)
+    {
+        const symbol_entry_t *entry = &table->entries[i];
+        index->addresses[i] = entry->address;
+        index->types[i] = (uint8_t)entry->type;
+        index->lines[i] = entry->line;
+        index->file_ids[i] = entry->filename ? symbols_files_id(table->files, entry->filename) + 1 : 0;
+        index->name_ids[i] = entry->name ? symbols_strpool_id(entry->name) + 1 : 0;
+    }
+
+    index->built |= SYMBOL_INDEX_PACKED;
+    return true;
+}
+
+// Fill the Eytzinger tree by an in-order walk, which visits the nodes in
+// sorted order.  The recursion is as deep as the tree (at most 33 levels).
+static size_t fill_eytzinger(struct symbol_index *index, size_t position, size_t k, size_t count)
+{
+    if (k > count)
+        return position;
+
+    position = fill_eytzinger(index, position, 2 * k, count);
+    index->eytzinger[k] = index->addresses[position];
+    index->eytzinger_rank[k] = (uint32_t)position;
+    return fill_eytzinger(index, position + 1, 2 * k + 1, count);
+}
+
+// Build the address search tree from the packed addresses
+static bool build_search(const symbol_table_t *table, struct symbol_index *index)
+{
+    if (table->count > SYMBOL_SEARCH_LINEAR_MAX)
+    {
+        index->eytzinger = symbols_arena_alloc(index->arena, (table->count + 1) * sizeof(uint16_t), sizeof(uint16_t));
+        index->eytzinger_rank = symbols_arena_alloc(index->arena, (table->count + 1) * sizeof(uint32_t), sizeof(uint32_t));
+        if (!index->eytzinger || !index->eytzinger_rank)
+            return false;
+
+        fill_eytzinger(index, 0, 1, table->count);
+    }
+
+    index->built |= SYMBOL_INDEX_SEARCH;
+    return true;
+}
+
+// Partition the entries by type (counting sort, stable)
+static bool build_types(const symbol_table_t *table, struct symbol_index *index)
+{
+    size_t count = 0;
+    memset(index->type_start, 0, sizeof(index->type_start));
+    for (size_t i = 0; i < table->count; i++)
+    {
+        unsigned type = table->entries[i].type;
+        if (type < SYMBOL_TYPE_PARTITIONS)
+        {
+            index->type_start[type + 1]++;
+            count++;
+        }
+    }
+    for (unsigned t = 0; t < SYMBOL_TYPE_PARTITIONS; t++)
+        index->type_start[t + 1] += index->type_start[t];
+
+    index->type_pos = symbols_arena_alloc(index->arena, (count ? count : 1) * sizeof(uint32_t), sizeof(uint32_t));
+    index->type_addr = symbols_arena_alloc(index->arena, (count ? count : 1) * sizeof(uint16_t), sizeof(uint16_t));
+    if (!index->type_pos || !index->type_addr)
+        return false;
+
+    uint32_t cursor[SYMBOL_TYPE_PARTITIONS];
+    memcpy(cursor, index->type_start, sizeof(cursor));
+    for (size_t i = 0; i < table->count; i++)
+    {
+        unsigned type = table->entries[i].type;
+        if (type < SYMBOL_TYPE_PARTITIONS)
+        {
+            index->type_pos[cursor[type]] = (uint32_t)i;
+            index->type_addr[cursor[type]] = table->entries[i].address;
+            cursor[type]++;
+        }
+    }
+    index->type_other = table->count - count;
+
+    index->built |= SYMBOL_INDEX_TYPES;
+    return true;
+}
+
+static int compare_names(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+// Collect the distinct entry names and sort them
+static bool build_sorted_names(const symbol_table_t *table, struct symbol_index *index)
+{
+    size_t string_count = table->strings->count;
+    uint8_t *seen = calloc(string_count ? string_count : 1, 1);
+    index->sorted_names = symbols_arena_alloc(index->arena, (string_count ? string_count : 1) * sizeof(const char *),
+                                              sizeof(const char *));
+    if (!seen || !index->sorted_names)
+    {
+        free(seen);
+        return false;
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < table->count; i++)
+    {
+        const char *name = table->entries[i].name;
+        if (name && !seen[symbols_strpool_id(name)])
+        {
+            seen[symbols_strpool_id(name)] = 1;
+            index->sorted_names[count++] = name;
+        }
+    }
+    free(seen);
+
+    qsort(index->sorted_names, count, sizeof(const char *), compare_names);
+    index->sorted_name_count = count;
+
+    index->built |= SYMBOL_INDEX_SORTED_NAMES;
+    return true;
+}
+
+// Pack the sorted names into one text buffer, plus a lower case copy
+static bool build_name_buffer(struct symbol_index *index)
+{
+    size_t size = 0;
+    for (size_t i = 0; i < index->sorted_name_count; i++)
+        size += strlen(index->sorted_names[i]) + 1;
+    if (size > UINT32_MAX)
+        return false;
+
+    index->name_text = symbols_arena_alloc(index->arena, size ? size : 1, 1);
+    index->name_text_folded = symbols_arena_alloc(index->arena, size ? size : 1, 1);
+    index->name_offsets = symbols_arena_alloc(index->arena, (index->sorted_name_count + 1) * sizeof(uint32_t),
+                                              sizeof(uint32_t));
+    if (!index->name_text || !index->name_text_folded || !index->name_offsets)
+        return false;
+
+    size_t offset = 0;
+    for (size_t i = 0; i < index->sorted_name_count; i++)
+    {
+        size_t length = strlen(index->sorted_names[i]) + 1;
+        index->name_offsets[i] = (uint32_t)offset;
+        memcpy(index->name_text + offset, index->sorted_names[i], length);
+        offset += length;
+    }
+    index->name_offsets[index->sorted_name_count] = (uint32_t)offset;
+    index->name_text_size = size;
+
+    for (size_t i = 0; i < size; i++)
+        index->name_text_folded[i] = (char)tolower((unsigned char)index->name_text[i]);
+
+    index->built |= SYMBOL_INDEX_NAME_BUFFER;
+    return true;
+}
+
+// Record the first FILE entry of every file, in table order
+static bool build_file_entries(const symbol_table_t *table, struct symbol_index *index)
+{
+    size_t file_count = table->files->count;
+
+    index->file_entry = symbols_arena_calloc(index->arena, file_count ? file_count : 1, sizeof(uint32_t));
+    if (!index->file_entry)
+        return false;
+
+    for (size_t i = 0; i < table->count; i++)
+    {
+        const symbol_entry_t *entry = &table->entries[i];
+        if (entry->type == SYMBOL_TYPE_FILE && entry->filename)
+        {
+            uint32_t file = symbols_files_id(table->files, entry->filename);
+            if (index->file_entry[file] == 0)
+                index->file_entry[file] = (uint32_t)i + 1;
+        }
+    }
+
+    index->built |= SYMBOL_INDEX_FILE_ENTRIES;
+    return true;
+}
+
+const struct symbol_index *symbols_index_get(const symbol_table_t *table, unsigned parts)
+{
+    if (!table || table->count > UINT32_MAX - 1)
+        return NULL;
+
+    // Safe: see the comment in symbols_index.h
+    symbol_table_t *mutable_table = (symbol_table_t *)table;
+    struct symbol_index *index = mutable_table->index;
+
+    // Fast path, and the only path for frozen tables: nothing to build
+    if (index && (index->built & parts) == parts)
+        return index;
+    if (table->frozen)
+        return NULL;
+
+    if (!index)
+    {
+        index = calloc(1, sizeof(*index));
+        if (!index)
+            return NULL;
+        index->arena = symbols_arena_create();
+        if (!index->arena)
+        {
+            free(index);
+            return NULL;
+        }
+        mutable_table->index = index;
+    }
+
+    if ((parts & SYMBOL_INDEX_NAMES) && !(index->built & SYMBOL_INDEX_NAMES))
+    {
+        if (!build_names(table, index))
+            return NULL;
+    }
+
+    if ((parts & SYMBOL_INDEX_LINE_MAP) && !(index->built & SYMBOL_INDEX_LINE_MAP))
+    {
+        if (!build_line_map(table, index))
+            return NULL;
+    }
+
+    if ((parts & SYMBOL_INDEX_FILE_LINES) && !(index->built & SYMBOL_INDEX_FILE_LINES))
+    {
+        if (!build_file_lines(table, index))
+            return NULL;
+    }
+
+    if ((parts & SYMBOL_INDEX_LINE_NEXT) && !(index->built & SYMBOL_INDEX_LINE_NEXT))
+    {
+        if (!build_line_next(table, index))
+            return NULL;
+    }
+
+    if ((parts & SYMBOL_INDEX_PACKED) && !(index->built & SYMBOL_INDEX_PACKED))
+    {
+        if (!build_packed(table, index))
+            return NULL;
+    }
+
+    if ((parts & SYMBOL_INDEX_SEARCH) && !(index->built & SYMBOL_INDEX_SEARCH))
+    {
+        if (!(index->built & SYMBOL_INDEX_PACKED) && !build_packed(table, index))
+            return NULL;
+        if (!build_search(table, index))
+            return NULL;
+    }
+
+    if ((parts & SYMBOL_INDEX_TYPES) && !(index->built & SYMBOL_INDEX_TYPES))
+    {
+        if (!build_types(table, index))
+            return NULL;
+    }
+
+    if ((parts & SYMBOL_INDEX_SORTED_NAMES) && !(index->built & SYMBOL_INDEX_SORTED_NAMES))
+    {
+        if (!build_sorted_names(table, index))
+            return NULL;
+    }
+
+    if ((parts & SYMBOL_INDEX_NAME_BUFFER) && !(index->built & SYMBOL_INDEX_NAME_BUFFER))
+    {
+        if (!(index->built & SYMBOL_INDEX_SORTED_NAMES) && !build_sorted_names(table, index))
+            return NULL;
+        if (!build_name_buffer(index))
+            return NULL;
+    }
+
+    if ((parts & SYMBOL_INDEX_FILE_ENTRIES) && !(index->built & SYMBOL_INDEX_FILE_ENTRIES))
+    {
+        if (!build_file_entries(table, index))
+            return NULL;
+    }
+
+    return index;
+}
+
+void symbols_index_invalidate(symbol_table_t *table)
+{
+    if (!table)
+        return;
+
+    // Cached lookup results point into the entries as well
+    table->generation = symbols_cache_next_generation();
+    if (!table->index)
+        return;
+
+    // All parts live in the arena; keep its largest block for the rebuild
+    struct symbol_arena *arena = table->index->arena;
+    symbols_arena_reset(arena);
+    memset(table->index, 0, sizeof(*table->index));
+    table->index->arena = arena;
+}
+
+void symbols_index_free(symbol_table_t *table)
+{
+    if (!table || !table->index)
+        return;
+
+    symbols_arena_free(table->index->arena);
+    free(table->index);
+    table->index = NULL;
+}
@@ -0,0 +1,133 @@
+#ifndef SYMBOLS_INDEX_H
+#define SYMBOLS_INDEX_H
+
+#include "symbols.h"
+
+// Internal: derived lookup indices over a symbol table's entries.
+//
+// Every index refers to entries by position (index into table->entries),
+// so they stay flat arrays of integers.  They are built on demand by
+// symbols_index_get() into the index arena, and thrown away together by
+// symbols_index_invalidate() whenever the entries change.
+
+// Index parts that can be requested from symbols_index_get()
+#define SYMBOL_INDEX_NAMES 0x01u    // Hash of entry names
+#define SYMBOL_INDEX_LINE_MAP 0x02u // Direct-mapped address -> LINE entry
+#define SYMBOL_INDEX_FILE_LINES 0x04u // Per-file LINE entries sorted by line
+#define SYMBOL_INDEX_LINE_NEXT 0x08u  // Next LINE entry in the same file
+#define SYMBOL_INDEX_FILE_ENTRIES 0x10u // First FILE entry of each file
+#define SYMBOL_INDEX_PACKED 0x20u       // Structure-of-arrays copy of the entries
+#define SYMBOL_INDEX_SEARCH 0x40u       // Eytzinger address search (implies PACKED)
+#define SYMBOL_INDEX_TYPES 0x80u        // Entries partitioned by type
+#define SYMBOL_INDEX_SORTED_NAMES 0x100u // Distinct names in strcmp order
+#define SYMBOL_INDEX_NAME_BUFFER 0x200u  // Packed name text (implies SORTED_NAMES)
+
+// Every part; the line map is only wanted when the line index is enabled
+#define SYMBOL_INDEX_ALL 0x3FFu
+
+// Number of type partitions: one per symbol_type_t value
+#define SYMBOL_TYPE_PARTITIONS (SYMBOL_TYPE_LINE + 1)
+
+// Number of slots in the direct-mapped line index (one per address)
+#define SYMBOL_LINE_MAP_SIZE 0x10000u
+
+struct symbol_arena;
+
+struct symbol_index
+{
+    struct symbol_arena *arena; // Storage for every part below
+    unsigned built;             // SYMBOL_INDEX_* parts that are present
+
+    // Name hash: open addressing over distinct names.  A slot holds the
+    // position + 1 of the first entry with that name (0 = empty), and
+    // name_next chains each entry to the next one with the same name.
+    uint32_t *name_slots;
+    size_t name_slot_count; // Power of two
+    uint32_t *name_next;    // One per entry, position + 1 (0 = end)
+
+    // Line map: for every 16-bit address, the position + 1 of the LINE
+    // entry find_source_entry() resolves it to (0 = outside mapped source).
+    // Only built when enabled with symbols_set_line_index().
+    uint32_t *line_map;
+
+    // Per-file line tables.  The LINE entries of file id F (see
+    // symbols_files.h) are file_line_pos[file_line_start[F] ..
+    // file_line_start[F + 1]), sorted by line and then position, with
+    // their line numbers copied to file_line_num for the binary search.
+    uint32_t *file_line_start; // One per registered file, plus one
+    int32_t *file_line_num;
+    uint32_t *file_line_pos;
+
+    // Successor table: for every LINE entry, the position + 1 of the first
+    // LINE entry of the same file at a strictly higher address (0 = none;
+    // also 0 for entries of other types).  One per entry.
+    uint32_t *line_next;
+
+    // Position + 1 of the first FILE entry of each file id (0 = none)
+    uint32_t *file_entry;
+
+    // Packed view of the entries as parallel arrays, one element per entry
+    // in table order.  symbol_entry_t is 40 bytes on 64-bit hosts; a binary
+    // search over 'addresses' reads 2 bytes per probe, and the type and
+    // line filters scan 1 and 4 bytes per entry instead of a whole entry.
+    uint16_t *addresses;
+    uint8_t *types;
+    int32_t *lines;
+    uint32_t *file_ids; // File id + 1 (0 = no filename)
+    uint32_t *name_ids; // Pool id + 1 (0 = no name)
+
+    // Address search tree (see symbols_search.h): the sorted addresses in
+    // Eytzinger order, 1-based, and each node's position in the table.
+    // Not built for tables small enough to be searched by counting.
+    uint16_t *eytzinger;
+    uint32_t *eytzinger_rank;
+
+    // Type partitions: the entries of type T are type_pos[type_start[T] ..
+    // type_start[T + 1]), in table order, with their addresses copied to
+    // type_addr.  A query for one type searches that type's entries only.
+    // Entries with a type outside symbol_type_t are counted in
+    // type_other and left out.
+    uint32_t type_start[SYMBOL_TYPE_PARTITIONS + 1];
+    uint32_t *type_pos;
+    uint16_t *type_addr;
+    size_t type_other;
+
+    // Distinct entry names (pooled) sorted with strcmp, for completion
+    const char **sorted_names;
+    size_t sorted_name_count;
+
+    // The sorted names packed back to back, each followed by its NUL, so a
+    // substring search is one pass over contiguous memory.  Name i starts
+    // at name_offsets[i]; name_text_folded is the same text in lower case.
+    char *name_text;
+    char *name_text_folded;
+    uint32_t *name_offsets; // sorted_name_count + 1 offsets
+    size_t name_text_size;
+};
+
+// Get the index with the requested parts built.  Lookup functions take a
+// const table, but the index is a cache: building it does not change any
+// entry, so the table is updated through a cast.  Returns NULL if memory
+// for the index could not be allocated.
+const struct symbol_index *symbols_index_get(const symbol_table_t *table, unsigned parts);
+
+// Drop all derived indices; called whenever entries are added or moved
+void symbols_index_invalidate(symbol_table_t *table);
+
+// Release the indices and their arena; called by symbols_free()
+void symbols_index_free(symbol_table_t *table);
+
+// Fill a zeroed SYMBOL_LINE_MAP_SIZE array with the line map (see
+// struct symbol_index), for callers that need it without keeping it
+void symbols_index_fill_line_map(const symbol_table_t *table, uint32_t *line_map);
+
+// Hash of a NUL terminated string
+uint32_t symbols_index_hash_string(const char *str);
+
+// Hash of a string pool id, used for name keyed indices
+static inline uint32_t symbols_index_hash_id(uint32_t id)
+{
+    return id * 2654435761u;
+}
+
+#endif /* SYMBOLS_INDEX_H */
@@ -0,0 +1,307 @@
+#include "symbols.h"
+#include "symbols_index.h"
+#include "symbols_query_stats.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <regex.h>
+#include <unistd.h>
+#define SYMBOLS_HAVE_POSIX 1
+#else
+#define SYMBOLS_HAVE_POSIX 0
+#endif
+
+// Name text per thread below which splitting a search does not pay off
+#define SEARCH_THREAD_MIN_BYTES (256u * 1024u)
+#define SEARCH_MAX_THREADS 8
+
+typedef struct
+{
+    uint32_t name; // Index into the sorted names
+    uint32_t match; // symbol_match_t
+} name_match_t;
+
+// One slice of the sorted names, searched by one thread
+typedef struct
+{
+    const struct symbol_index *index;
+    const char *text;     // name_text, or name_text_folded to ignore case
+    const char *pattern;  // Folded too when ignoring case
+    size_t pattern_length;
+    const void *regex;    // regex_t, or NULL for a substring search
+    size_t begin;         // Names [begin, end)
+    size_t end;
+    name_match_t *matches;
+    size_t count;
+    size_t capacity;
+    bool failed;          // Out of memory
+} search_chunk_t;
+
+static void add_match(search_chunk_t *chunk, size_t name, symbol_match_t match)
+{
+    if (chunk->count == chunk->capacity)
+    {
+        size_t capacity = chunk->capacity ? chunk->capacity * 2 : 64;
+        name_match_t *matches = realloc(chunk->matches, capacity * sizeof(name_match_t));
+        if (!matches)
+        {
+            chunk->failed = true;
+            return;
+        }
+        chunk->matches = matches;
+        chunk->capacity = capacity;
+    }
+
+    chunk->matches[chunk->count].name = (uint32_t)name;
+    chunk->matches[chunk->count].match = match;
+    chunk->count++;
+}
+
+// Substring search over the packed text: memchr finds candidates for the
+// first character, and a match never crosses a name's terminating NUL
+static void scan_substring(search_chunk_t *chunk)
+{
+    const uint32_t *offsets = chunk->index->name_offsets;
+    const char *text = chunk->text;
+    const char *pattern = chunk->pattern;
+    size_t length = chunk->pattern_length;
+
+    if (length == 0)
+    {
+        for (size_t name = chunk->begin; name < chunk->end; name++)
+            add_match(chunk, name, offsets[name + 1] - offsets[name] == 1 ? SYMBOL_MATCH_EXACT : SYMBOL_MATCH_PREFIX);
+        return;
+    }
+
+    const char *p = text + offsets[chunk->begin];
+    const char *end = text + offsets[chunk->end];
+    size_t name = chunk->begin;
+    while (!chunk->failed && (size_t)(end - p) > length &&
+           (p = memchr(p, pattern[0], (size_t)(end - p) - length)) != NULL)
+    {
+        if (memcmp(p, pattern, length) != 0)
+        {
+            p++;
+            continue;
+        }
+
+        size_t at = (size_t)(p - text);
+        while (offsets[name + 1] <= at)
+            name++;
+
+        symbol_match_t match = SYMBOL_MATCH_SUBSTRING;
+        if (at == offsets[name])
+            match = offsets[name + 1] - offsets[name] == length + 1 ? SYMBOL_MATCH_EXACT : SYMBOL_MATCH_PREFIX;
+        add_match(chunk, name, match);
+
+        // One report per name: continue with the next one
+        p = text + offsets[name + 1];
+    }
+}
+
+#if SYMBOLS_HAVE_POSIX
+static void scan_regex(search_chunk_t *chunk)
+{
+    const regex_t *regex = chunk->regex;
+
+    for (size_t name = chunk->begin; name < chunk->end && !chunk->failed; name++)
+    {
+        const char *text = chunk->index->sorted_names[name];
+        regmatch_t m;
+        if (regexec(regex, text, 1, &m, 0) != 0)
+            continue;
+
+        symbol_match_t match = SYMBOL_MATCH_SUBSTRING;
+        if (m.rm_so == 0)
+            match = text[m.rm_eo] == '\0' ? SYMBOL_MATCH_EXACT : SYMBOL_MATCH_PREFIX;
+        add_match(chunk, name, match);
+    }
+}
+#endif
+
+static void *scan_chunk(void *arg)
+{
+    search_chunk_t *chunk = (search_chunk_t *)arg;
+
+#if SYMBOLS_HAVE_POSIX
+    if (chunk->regex)
+    {
+        scan_regex(chunk);
+        return NULL;
+    }
+#endif
+    scan_substring(chunk);
+    return NULL;
+}
+
+static unsigned search_threads(const struct symbol_index *index)
+{
+#if SYMBOLS_HAVE_POSIX
+    size_t threads = index->name_text_size / SEARCH_THREAD_MIN_BYTES;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus > 0 && threads > (size_t)cpus)
+        threads = (size_t)cpus;
+    if (threads > SEARCH_MAX_THREADS)
+        threads = SEARCH_MAX_THREADS;
+    return threads ? (unsigned)threads : 1;
+#else
+    (void)index;
+    return 1;
+#endif
+}
+
+// Split the names into slices of about equal text size and scan them
+static bool scan_all(search_chunk_t *chunks, unsigned threads)
+{
+    const struct symbol_index *index = chunks[0].index;
+    size_t names = index->sorted_name_count;
+
+    size_t begin = 0;
+    for (unsigned t = 0; t < threads; t++)
+    {
+        size_t end = names;
+        if (t + 1 < threads)
+        {
+            // First name starting at or after this slice's share of the text
+            size_t target = index->name_text_size / threads * (t + 1);
+            size_t lo = begin, hi = names;
+            while (lo < hi)
+            {
+                size_t mid = lo + (hi - lo) / 2;
+                if (index->name_offsets[mid] < target)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            end = lo;
+        }
+        chunks[t].begin = begin;
+        chunks[t].end = end;
+        begin = end;
+    }
+
+#if SYMBOLS_HAVE_POSIX
+    pthread_t ids[SEARCH_MAX_THREADS];
+    unsigned started = 1;
+    while (started < threads && pthread_create(&ids[started], NULL, scan_chunk, &chunks[started]) == 0)
+        started++;
+
+    scan_chunk(&chunks[0]);
+    for (unsigned t = 1; t < started; t++)
+        pthread_join(ids[t], NULL);
+    for (unsigned t = started; t < threads; t++)
+        scan_chunk(&chunks[t]);
+#else
+    scan_chunk(&chunks[0]);
+#endif
+
+    for (unsigned t = 0; t < threads; t++)
+    {
+        if (chunks[t].failed)
+            return false;
+    }
+    return true;
+}
+
+/// @brief Searches the distinct entry names for a substring or regex
+/// @param table Pointer to the symbol table
+/// @param pattern Substring, or POSIX extended regex with SYMBOL_SEARCH_REGEX
+/// @param flags SYMBOL_SEARCH_* flags
+/// @param callback Called per matching name, best matches first
+/// @param user_data Passed through to the callback
+/// @return Number of names passed to the callback (0 on error)
+///
+/// Substring searches scan the packed name text (folded to lower case for
+/// SYMBOL_SEARCH_IGNORE_CASE).  Matches are reported grouped by
+/// symbol_match_t, and in strcmp order within a group.  Regex searches are
+/// not available on Windows.
+static size_t search_names(const symbol_table_t *table, const char *pattern, unsigned flags,
+                           symbol_search_callback_t callback, void *user_data)
+{
+    if (!table || !pattern || !callback)
+        return 0;
+
+    const struct symbol_index *index = symbols_index_get(table, SYMBOL_INDEX_NAME_BUFFER | SYMBOL_INDEX_NAMES);
+    if (!index || index->sorted_name_count == 0)
+        return 0;
+
+    search_chunk_t chunks[SEARCH_MAX_THREADS];
+    unsigned threads = search_threads(index);
+    memset(chunks, 0, sizeof(chunks));
+
+    size_t length = strlen(pattern);
+    char *folded = NULL;
+#if SYMBOLS_HAVE_POSIX
+    regex_t regex;
+#endif
+
+    if (flags & SYMBOL_SEARCH_REGEX)
+    {
+#if SYMBOLS_HAVE_POSIX
+        int cflags = REG_EXTENDED | ((flags & SYMBOL_SEARCH_IGNORE_CASE) ? REG_ICASE : 0);
+        if (regcomp(&regex, pattern, cflags) != 0)
+            return 0;
+        chunks[0].regex = &regex;
+#else
+        return 0;
+#endif
+    }
+    else if (flags & SYMBOL_SEARCH_IGNORE_CASE)
+    {
+        folded = malloc(length + 1);
+        if (!folded)
+            return 0;
+        for (size_t i = 0; i <= length; i++)
+            folded[i] = (char)tolower((unsigned char)pattern[i]);
+    }
+
+    for (unsigned t = 0; t < threads; t++)
+    {
+        chunks[t].index = index;
+        chunks[t].text = folded ? index->name_text_folded : index->name_text;
+        chunks[t].pattern = folded ? folded : pattern;
+        chunks[t].pattern_length = length;
+        chunks[t].regex = chunks[0].regex;
+    }
+
+    bool ok = scan_all(chunks, threads);
+
+#if SYMBOLS_HAVE_POSIX
+    if (chunks[0].regex)
+        regfree(&regex);
+#endif
+    free(folded);
+
+    // Report by match kind; the slices are in name order, and so is each
+    // slice's list
+    size_t reported = 0;
+    bool stop = !ok;
+    for (unsigned match = SYMBOL_MATCH_EXACT; match <= SYMBOL_MATCH_SUBSTRING && !stop; match++)
+    {
+        for (unsigned t = 0; t < threads && !stop; t++)
+        {
+            for (size_t i = 0; i < chunks[t].count && !stop; i++)
+            {
+                if (chunks[t].matches[i].match != match)
+                    continue;
+
+                const symbol_entry_t *entry = symbols_lookup_by_name(table, index->sorted_names[chunks[t].matches[i].name]);
+                reported++;
+                stop = !callback(entry, (symbol_match_t)match, user_data);
+            }
+        }
+    }
+
+    for (unsigned t = 0; t < threads; t++)
+        free(chunks[t].matches);
+    return reported;
+}
+
+size_t symbols_search(const symbol_table_t *table, const char *pattern, unsigned flags,
+                      symbol_search_callback_t callback, void *user_data)
+{
+    SYMBOLS_QUERY(SYMBOL_QUERY_SEARCH, size_t, search_names(table, pattern, flags, callback, user_data));
+}
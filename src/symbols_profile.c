@@ -0,0 +1,169 @@
+#include "symbols_profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+SYMBOLS_THREAD_LOCAL symbol_load_profile_t *symbols_load_profile_active;
+
+static const char *const phase_names[SYMBOL_LOAD_PHASE_COUNT] = {
+    "parse", "intern", "sort", "merge", "index",
+};
+
+uint64_t symbols_profile_clock(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER frequency, now;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)(now.QuadPart / frequency.QuadPart) * 1000000000u +
+           (uint64_t)(now.QuadPart % frequency.QuadPart) * 1000000000u / (uint64_t)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+#endif
+}
+
+symbol_load_profile_t *symbols_load_profile_create(void)
+{
+    symbol_load_profile_t *profile = calloc(1, sizeof(symbol_load_profile_t));
+    if (!profile)
+        return NULL;
+
+    profile->origin = symbols_profile_clock();
+    return profile;
+}
+
+void symbols_load_profile_free(symbol_load_profile_t *profile)
+{
+    if (!profile)
+        return;
+
+    if (symbols_load_profile_active == profile)
+        symbols_load_profile_active = NULL;
+    for (size_t i = 0; i < profile->event_count; i++)
+        free(profile->events[i].file);
+    free(profile->events);
+    free(profile);
+}
+
+symbol_load_profile_t *symbols_load_profile_attach(symbol_load_profile_t *profile)
+{
+    symbol_load_profile_t *previous = symbols_load_profile_active;
+    symbols_load_profile_active = profile;
+    return previous;
+}
+
+void symbols_load_profile_get_stats(const symbol_load_profile_t *profile, symbol_load_stats_t *stats)
+{
+    if (!stats)
+        return;
+
+    if (profile)
+        *stats = profile->stats;
+    else
+        memset(stats, 0, sizeof(*stats));
+}
+
+// Append an event; the totals are kept even if the event list cannot grow
+static struct symbol_load_event *add_event(symbol_load_profile_t *profile, int phase,
+                                           uint64_t start, uint64_t end, size_t items)
+{
+    if (profile->event_count == profile->event_capacity)
+    {
+        size_t capacity = profile->event_capacity ? profile->event_capacity * 2 : 64;
+        struct symbol_load_event *events = realloc(profile->events, capacity * sizeof(*events));
+        if (!events)
+            return NULL;
+        profile->events = events;
+        profile->event_capacity = capacity;
+    }
+
+    struct symbol_load_event *event = &profile->events[profile->event_count++];
+    event->phase = phase;
+    event->file = NULL;
+    event->start = start - profile->origin;
+    event->duration = end - start;
+    event->items = items;
+    return event;
+}
+
+void symbols_profile_end(symbol_load_phase_t phase, uint64_t start, size_t items)
+{
+    symbol_load_profile_t *profile = symbols_load_profile_active;
+    if (!profile)
+        return;
+
+    uint64_t end = symbols_profile_clock();
+    profile->stats.phase_ns[phase] += end - start;
+    profile->stats.phase_runs[phase]++;
+    add_event(profile, (int)phase, start, end, items);
+}
+
+void symbols_profile_end_load(const char *file, uint64_t start, size_t items)
+{
+    symbol_load_profile_t *profile = symbols_load_profile_active;
+    if (!profile)
+        return;
+
+    uint64_t end = symbols_profile_clock();
+    profile->stats.load_ns += end - start;
+    profile->stats.files_loaded++;
+    struct symbol_load_event *event = add_event(profile, -1, start, end, items);
+    if (event && file)
+        event->file = strdup(file);
+}
+
+static void write_json_string(FILE *out, const char *str)
+{
+    fputc('"', out);
+    for (const unsigned char *p = (const unsigned char *)str; *p; p++)
+    {
+        if (*p == '"' || *p == '\\')
+            fprintf(out, "\\%c", *p);
+        else if (*p < 0x20)
+            fprintf(out, "\\u%04x", *p);
+        else
+            fputc(*p, out);
+    }
+    fputc('"', out);
+}
+
+bool symbols_load_profile_write_trace(const symbol_load_profile_t *profile, const char *path)
+{
+    if (!profile || !path)
+        return false;
+
+    FILE *out = fopen(path, "w");
+    if (!out)
+        return false;
+
+    // Complete ("X") events with microsecond timestamps; the phases of a
+    // load nest inside it by time
+    fprintf(out, "{\"traceEvents\":[");
+    for (size_t i = 0; i < profile->event_count; i++)
+    {
+        const struct symbol_load_event *event = &profile->events[i];
+        fprintf(out, "%s\n{\"name\":\"%s\",\"cat\":\"symbols\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+                     "\"ts\":%.3f,\"dur\":%.3f,\"args\":{",
+                i ? "," : "", event->phase < 0 ? "load" : phase_names[event->phase],
+                event->start / 1000.0, event->duration / 1000.0);
+        if (event->file)
+        {
+            fprintf(out, "\"file\":");
+            write_json_string(out, event->file);
+            fprintf(out, ",");
+        }
+        fprintf(out, "\"items\":%zu}}", event->items);
+    }
+    fprintf(out, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+    bool ok = !ferror(out);
+    return fclose(out) == 0 && ok;
+}
@@ -0,0 +1,60 @@
+#ifndef SYMBOLS_PROFILE_H
+#define SYMBOLS_PROFILE_H
+
+#include "symbols.h"
+#include "symbols_cache.h"
+
+// Internal: load profiling hooks.
+//
+// The profile attached to the calling thread is symbols_load_profile_active
+// (NULL when profiling is off).  Phases are timed with
+//     uint64_t start = symbols_profile_start();
+//     ...
+//     symbols_profile_end(SYMBOL_LOAD_PHASE_..., start, items);
+// and counters are bumped with SYMBOLS_PROFILE_ADD(); all of them do
+// nothing but test the pointer when no profile is attached.
+
+// Name, start and duration of one recorded phase or file load
+struct symbol_load_event
+{
+    int phase;          // symbol_load_phase_t, or -1 for a whole file load
+    char *file;         // File loads only (owned)
+    uint64_t start;     // Nanoseconds since the profile was created
+    uint64_t duration;
+    size_t items;       // Entries or lines processed
+};
+
+struct symbol_load_profile
+{
+    symbol_load_stats_t stats;
+    uint64_t origin;    // symbols_profile_clock() at creation
+    struct symbol_load_event *events;
+    size_t event_count;
+    size_t event_capacity;
+};
+
+extern SYMBOLS_THREAD_LOCAL symbol_load_profile_t *symbols_load_profile_active;
+
+#define SYMBOLS_PROFILE_ADD(field, n)                          \
+    do                                                         \
+    {                                                          \
+        if (symbols_load_profile_active)                       \
+            symbols_load_profile_active->stats.field += (n);   \
+    } while (0)
+
+// Monotonic clock in nanoseconds
+uint64_t symbols_profile_clock(void);
+
+// Start time of a phase (0 when not profiling)
+static inline uint64_t symbols_profile_start(void)
+{
+    return symbols_load_profile_active ? symbols_profile_clock() : 0;
+}
+
+// Record a phase that started at 'start' and processed 'items'
+void symbols_profile_end(symbol_load_phase_t phase, uint64_t start, size_t items);
+
+// Record the load of 'file' that started at 'start'
+void symbols_profile_end_load(const char *file, uint64_t start, size_t items);
+
+#endif /* SYMBOLS_PROFILE_H */
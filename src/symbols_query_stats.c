@@ -0,0 +1,172 @@
+#include "symbols_query_stats.h"
+#include "symbols_atomic.h"
+#include "symbols_cache.h"
+#include "symbols_profile.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *const query_names[SYMBOL_QUERY_COUNT] = {
+    "symbols_lookup_by_address",
+    "symbols_lookup_floor",
+    "symbols_lookup_range",
+    "symbols_lookup_by_name",
+    "symbols_lookup_next_by_name",
+    "symbols_find_address",
+    "symbols_get_file",
+    "symbols_get_line",
+    "symbols_get_next_line_address",
+    "symbols_get_source_files",
+    "symbols_resolve_batch",
+    "symbols_find_function_at",
+    "symbols_get_variables",
+    "symbols_complete_name",
+    "symbols_complete_function",
+    "symbols_search",
+};
+
+const char *symbols_query_name(symbol_query_t query)
+{
+    if ((unsigned)query >= SYMBOL_QUERY_COUNT)
+        return NULL;
+    return query_names[query];
+}
+
+#if SYMBOLS_QUERY_STATS
+
+// The counters of one thread.  Only the owner adds to them, with relaxed
+// loads and stores rather than locked instructions; readers may see a call
+// counted before its histogram bucket.
+struct query_counter
+{
+    volatile uint64_t calls;
+    volatile uint64_t total_ns;
+    volatile uint64_t histogram[SYMBOL_QUERY_HISTOGRAM_BUCKETS];
+};
+
+struct query_thread
+{
+    struct query_thread *next;
+    struct query_counter queries[SYMBOL_QUERY_COUNT];
+};
+
+// Every thread that ever counted a query, newest first.  Blocks are never
+// freed, so the counts of threads that have exited still add up.
+static struct query_thread *query_threads;
+static volatile size_t query_threads_lock;
+
+static SYMBOLS_THREAD_LOCAL struct query_thread *query_thread;
+static SYMBOLS_THREAD_LOCAL unsigned query_depth;
+
+static void lock_threads(void)
+{
+    while (!symbols_atomic_try_lock(&query_threads_lock))
+        symbols_atomic_yield();
+}
+
+static struct query_thread *register_thread(void)
+{
+    struct query_thread *thread = calloc(1, sizeof(struct query_thread));
+    if (!thread)
+        return NULL;
+
+    lock_threads();
+    thread->next = query_threads;
+    query_threads = thread;
+    symbols_atomic_unlock(&query_threads_lock);
+    return thread;
+}
+
+static unsigned histogram_bucket(uint64_t ns)
+{
+    unsigned bucket = 0;
+#if defined(__GNUC__)
+    if (ns)
+        bucket = 64 - (unsigned)__builtin_clzll(ns);
+#else
+    while (ns)
+    {
+        ns >>= 1;
+        bucket++;
+    }
+#endif
+    return bucket < SYMBOL_QUERY_HISTOGRAM_BUCKETS ? bucket : SYMBOL_QUERY_HISTOGRAM_BUCKETS - 1;
+}
+
+static void add(volatile uint64_t *counter, uint64_t n)
+{
+    symbols_atomic_store_relaxed(counter, symbols_atomic_load_relaxed(counter) + n);
+}
+
+uint64_t symbols_query_begin(void)
+{
+    return query_depth++ ? 0 : symbols_profile_clock();
+}
+
+void symbols_query_end(symbol_query_t query, uint64_t start)
+{
+    if (--query_depth)
+        return;
+
+    uint64_t ns = symbols_profile_clock() - start;
+    if (!query_thread && !(query_thread = register_thread()))
+        return;
+
+    struct query_counter *counter = &query_thread->queries[query];
+    add(&counter->calls, 1);
+    add(&counter->total_ns, ns);
+    add(&counter->histogram[histogram_bucket(ns)], 1);
+}
+
+bool symbols_get_query_stats(symbol_query_stats_t *stats)
+{
+    if (!stats)
+        return false;
+
+    memset(stats, 0, sizeof(*stats));
+    lock_threads();
+    for (struct query_thread *thread = query_threads; thread; thread = thread->next)
+    {
+        for (unsigned q = 0; q < SYMBOL_QUERY_COUNT; q++)
+        {
+            const struct query_counter *counter = &thread->queries[q];
+            stats->queries[q].calls += symbols_atomic_load_relaxed(&counter->calls);
+            stats->queries[q].total_ns += symbols_atomic_load_relaxed(&counter->total_ns);
+            for (unsigned b = 0; b < SYMBOL_QUERY_HISTOGRAM_BUCKETS; b++)
+                stats->queries[q].histogram[b] += symbols_atomic_load_relaxed(&counter->histogram[b]);
+        }
+    }
+    symbols_atomic_unlock(&query_threads_lock);
+    return true;
+}
+
+void symbols_reset_query_stats(void)
+{
+    lock_threads();
+    for (struct query_thread *thread = query_threads; thread; thread = thread->next)
+    {
+        for (unsigned q = 0; q < SYMBOL_QUERY_COUNT; q++)
+        {
+            struct query_counter *counter = &thread->queries[q];
+            symbols_atomic_store_relaxed(&counter->calls, 0);
+            symbols_atomic_store_relaxed(&counter->total_ns, 0);
+            for (unsigned b = 0; b < SYMBOL_QUERY_HISTOGRAM_BUCKETS; b++)
+                symbols_atomic_store_relaxed(&counter->histogram[b], 0);
+        }
+    }
+    symbols_atomic_unlock(&query_threads_lock);
+}
+
+#else
+
+bool symbols_get_query_stats(symbol_query_stats_t *stats)
+{
+    if (stats)
+        memset(stats, 0, sizeof(*stats));
+    return false;
+}
+
+void symbols_reset_query_stats(void)
+{
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef SYMBOLS_QUERY_STATS_H
+#define SYMBOLS_QUERY_STATS_H
+
+#include "symbols.h"
+
+// Internal: query counters, compiled in with SYMBOLS_QUERY_STATS.
+//
+// A public query forwards to its implementation through
+//     SYMBOLS_QUERY(SYMBOL_QUERY_..., result_type, implementation(...));
+// which returns the call's result and, when counting, times it.  Only the
+// outermost query of a thread is recorded, so queries built on other
+// queries count once.  Without SYMBOLS_QUERY_STATS the macro is a plain
+// return.
+
+#if SYMBOLS_QUERY_STATS
+
+// Enter a query; returns its start time
+uint64_t symbols_query_begin(void);
+
+// Leave a query that started at 'start', counting it if it was outermost
+void symbols_query_end(symbol_query_t query, uint64_t start);
+
+#define SYMBOLS_QUERY(query, type, call)                   \
+    do                                                     \
+    {                                                      \
+        uint64_t query_start = symbols_query_begin();      \
+        type query_result = (call);                        \
+        symbols_query_end((query), query_start);           \
+        return query_result;                               \
+    } while (0)
+
+#else
+
+#define SYMBOLS_QUERY(query, type, call) return (call)
+
+#endif
+
+#endif /* SYMBOLS_QUERY_STATS_H */
@@ -0,0 +1,104 @@
+#ifndef SYMBOLS_SEARCH_H
+#define SYMBOLS_SEARCH_H
+
+#include "symbols_index.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Internal: branch-free lower bound over the sorted entry addresses.
+//
+// Tables up to SYMBOL_SEARCH_LINEAR_MAX entries count the addresses below
+// the key (the lower bound of a sorted array), eight 16-bit lanes at a time
+// with SSE2.  Larger tables search the Eytzinger copy of the addresses:
+// the i-th node's children are 2i and 2i + 1, so the descent is a fixed
+// number of steps with no data-dependent branch, and the nodes several
+// levels down share one cache line that can be prefetched.
+
+// Largest table searched by counting
+#define SYMBOL_SEARCH_LINEAR_MAX 64
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SYMBOL_SEARCH_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define SYMBOL_SEARCH_PREFETCH(p) ((void)0)
+#endif
+
+// Number of addresses in a[0, n) that are < key
+static inline size_t symbols_search_count_below(const uint16_t *a, size_t n, uint32_t key)
+{
+    if (key > UINT16_MAX)
+        return n;
+
+    size_t count = 0;
+    size_t i = 0;
+#if defined(__SSE2__)
+    // SSE2 has no unsigned 16-bit compare: flip the sign bits and compare signed
+    const __m128i bias = _mm_set1_epi16((short)0x8000);
+    const __m128i k = _mm_set1_epi16((short)(key ^ 0x8000u));
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(a + i)), bias);
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmplt_epi16(v, k));
+        count += (size_t)__builtin_popcount(mask) / 2;
+    }
+#endif
+    for (; i < n; i++)
+        count += a[i] < key;
+    return count;
+}
+
+// Position of the first address >= key in the index's sorted entries
+// (count if none).  Keys above UINT16_MAX give the end, so an upper bound
+// for address A is the lower bound of A + 1.
+static inline size_t symbols_search_lower_bound(const struct symbol_index *index, size_t count, uint32_t key)
+{
+    if (count <= SYMBOL_SEARCH_LINEAR_MAX)
+        return symbols_search_count_below(index->addresses, count, key);
+
+    const uint16_t *tree = index->eytzinger;
+    size_t k = 1;
+    while (k <= count)
+    {
+        // 32 addresses per 64-byte line: the descendants 5 levels down
+        SYMBOL_SEARCH_PREFETCH(tree + k * 32);
+        k = 2 * k + (tree[k] < key);
+    }
+
+    // Undo the right turns taken after the last left turn; the node where
+    // that left turn was taken is the answer (0 if there was none)
+#if defined(__GNUC__) || defined(__clang__)
+    k >>= __builtin_ctzll(~(unsigned long long)k) + 1;
+#else
+    while (k & 1)
+        k >>= 1;
+    k >>= 1;
+#endif
+    return k ? index->eytzinger_rank[k] : count;
+}
+
+// Position in type_pos of the first entry of type 'type' whose address is
+// >= key (the end of the partition if none).  Small partitions are counted,
+// larger ones binary searched over their 2-byte addresses.
+static inline size_t symbols_search_type_lower_bound(const struct symbol_index *index, unsigned type, uint32_t key)
+{
+    size_t begin = index->type_start[type];
+    size_t n = index->type_start[type + 1] - begin;
+    const uint16_t *a = index->type_addr + begin;
+
+    if (n <= SYMBOL_SEARCH_LINEAR_MAX)
+        return begin + symbols_search_count_below(a, n, key);
+
+    while (n > 1)
+    {
+        size_t half = n / 2;
+        SYMBOL_SEARCH_PREFETCH(a + half / 2);
+        SYMBOL_SEARCH_PREFETCH(a + half + half / 2);
+        a = a[half] < key ? a + half : a;
+        n -= half;
+    }
+    return (size_t)(a - index->type_addr) + (*a < key);
+}
+
+#endif /* SYMBOLS_SEARCH_H */
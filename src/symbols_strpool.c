@@ -0,0 +1,121 @@
+#include "symbols_strpool.h"
+#include "symbols_arena.h"
+#include "symbols_index.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct symbol_strpool *symbols_strpool_create(struct symbol_arena *arena)
+{
+    if (!arena)
+        return NULL;
+
+    struct symbol_strpool *pool = calloc(1, sizeof(struct symbol_strpool));
+    if (pool)
+        pool->arena = arena;
+    return pool;
+}
+
+void symbols_strpool_free(struct symbol_strpool *pool)
+{
+    if (!pool)
+        return;
+
+    // The strings themselves are released with the arena
+    free(pool->strings);
+    free(pool->slots);
+    free(pool);
+}
+
+// Find the slot for 'str', or the empty slot where it belongs
+static uint32_t *find_slot(const struct symbol_strpool *pool, const char *str, uint32_t hash)
+{
+    size_t mask = pool->slot_count - 1;
+    size_t i = hash & mask;
+
+    while (pool->slots[i] != 0 && strcmp(pool->strings[pool->slots[i] - 1], str) != 0)
+        i = (i + 1) & mask;
+
+    return &pool->slots[i];
+}
+
+static bool grow_slots(struct symbol_strpool *pool)
+{
+    size_t slot_count = pool->slot_count ? pool->slot_count * 2 : 256;
+    uint32_t *slots = calloc(slot_count, sizeof(uint32_t));
+    if (!slots)
+        return false;
+
+    free(pool->slots);
+    pool->slots = slots;
+    pool->slot_count = slot_count;
+
+    for (size_t id = 0; id < pool->count; id++)
+    {
+        const char *str = pool->strings[id];
+        *find_slot(pool, str, symbols_index_hash_string(str)) = (uint32_t)id + 1;
+    }
+    return true;
+}
+
+// Copy a string into arena storage, preceded by its id
+static const char *store(struct symbol_strpool *pool, const char *str, size_t len, uint32_t id)
+{
+    // Keep records 4-byte aligned so the id can be read directly
+    char *p = symbols_arena_alloc(pool->arena, sizeof(uint32_t) + len + 1, sizeof(uint32_t));
+    if (!p)
+        return NULL;
+
+    memcpy(p, &id, sizeof(id));
+    memcpy(p + sizeof(id), str, len + 1);
+    return p + sizeof(id);
+}
+
+const char *symbols_strpool_intern(struct symbol_strpool *pool, const char *str)
+{
+    if (!pool || !str)
+        return NULL;
+
+    if ((pool->count + 1) * 2 > pool->slot_count && !grow_slots(pool))
+        return NULL;
+
+    uint32_t hash = symbols_index_hash_string(str);
+    uint32_t *slot = find_slot(pool, str, hash);
+    if (*slot != 0)
+    {
+        pool->duplicates++;
+        pool->duplicate_bytes += strlen(str) + 1;
+        return pool->strings[*slot - 1];
+    }
+
+    if (pool->count >= UINT32_MAX - 1)
+        return NULL;
+
+    if (pool->count >= pool->capacity)
+    {
+        size_t capacity = pool->capacity ? pool->capacity * 2 : 64;
+        const char **strings = realloc(pool->strings, capacity * sizeof(*strings));
+        if (!strings)
+            return NULL;
+        pool->strings = strings;
+        pool->capacity = capacity;
+    }
+
+    size_t len = strlen(str);
+    const char *pooled = store(pool, str, len, (uint32_t)pool->count);
+    if (!pooled)
+        return NULL;
+
+    pool->strings[pool->count++] = pooled;
+    pool->string_bytes += len + 1;
+    *slot = (uint32_t)pool->count;
+    return pooled;
+}
+
+const char *symbols_strpool_find(const struct symbol_strpool *pool, const char *str)
+{
+    if (!pool || !str || pool->count == 0)
+        return NULL;
+
+    uint32_t slot = *find_slot(pool, str, symbols_index_hash_string(str));
+    return slot ? pool->strings[slot - 1] : NULL;
+}
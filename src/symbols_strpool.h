@@ -0,0 +1,49 @@
+#ifndef SYMBOLS_STRPOOL_H
+#define SYMBOLS_STRPOOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Internal: per-table string interning pool.
+//
+// Every distinct string is stored once, so entries can share filename and
+// name pointers and two pooled strings are equal exactly when their
+// pointers are.  Each string is preceded by its 32-bit id, which makes
+// symbols_strpool_id() a single load.
+
+struct symbol_arena;
+
+struct symbol_strpool
+{
+    struct symbol_arena *arena;          // String storage
+    const char **strings;                // Interned strings by id
+    size_t count;                        // Number of distinct strings
+    size_t capacity;                     // Capacity of 'strings'
+    uint32_t *slots;                     // Hash set: id + 1 (0 = empty)
+    size_t slot_count;                   // Power of two
+    size_t string_bytes;                 // Bytes of distinct strings incl. NUL
+    size_t duplicates;                   // Interns that hit an existing string
+    size_t duplicate_bytes;              // Their bytes incl. NUL
+};
+
+// Create a pool that stores its strings in 'arena' (owned by the caller)
+struct symbol_strpool *symbols_strpool_create(struct symbol_arena *arena);
+void symbols_strpool_free(struct symbol_strpool *pool);
+
+// Return the pooled copy of 'str', adding it if needed (NULL on failure)
+const char *symbols_strpool_intern(struct symbol_strpool *pool, const char *str);
+
+// Return the pooled copy of 'str' if it was interned, NULL otherwise
+const char *symbols_strpool_find(const struct symbol_strpool *pool, const char *str);
+
+// Id of a string returned by symbols_strpool_intern()
+static inline uint32_t symbols_strpool_id(const char *pooled)
+{
+    uint32_t id;
+    memcpy(&id, pooled - sizeof(uint32_t), sizeof(id));
+    return id;
+}
+
+#endif /* SYMBOLS_STRPOOL_H */
@@ -0,0 +1,100 @@
+// The reader checks must also run in release builds
+#undef NDEBUG
+
+#include "../include/symbols.h"
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_READERS 4
+#define NUM_RELOADS 50
+#define NUM_ENTRIES 2000
+
+static volatile int done = 0;
+static int started = 0;
+
+// Every entry of generation 'gen' has line gen, so a reader can tell a
+// table that was freed or mixed up from the one it was handed
+static symbol_table_t* make_table(int gen) {
+    symbol_table_t* table = symbols_create();
+    assert(table != NULL);
+    symbol_entry_t* batch = calloc(NUM_ENTRIES, sizeof(symbol_entry_t));
+    assert(batch != NULL);
+    for (int i = 0; i < NUM_ENTRIES; i++) {
+        batch[i].filename = "main.c";
+        batch[i].line = gen;
+        batch[i].address = (uint16_t)(i * 4 + gen % 4);
+        batch[i].type = SYMBOL_TYPE_LINE;
+    }
+    bool ok = symbols_add_entries_bulk(table, batch, NUM_ENTRIES);
+    assert(ok);
+    free(batch);
+    return table;
+}
+
+static void* reader_thread(void* arg) {
+    symbols_handle_t* handle = arg;
+    size_t reads = 0;
+    unsigned seed = (unsigned)(size_t)&reads;
+    while (!__atomic_load_n(&done, __ATOMIC_SEQ_CST)) {
+        symbols_reader_t reader;
+        const symbol_table_t* table = symbols_handle_read_begin(handle, &reader);
+        assert(table != NULL && table->count == NUM_ENTRIES);
+        int gen = table->entries[0].line;
+        for (int k = 0; k < 16; k++) {
+            uint16_t address = (uint16_t)(4 + rand_r(&seed) % (NUM_ENTRIES * 4 - 4));
+            assert(symbols_get_line(table, address) == gen);
+        }
+        assert(table->entries[table->count - 1].line == gen);
+        symbols_handle_read_end(&reader);
+        if (reads++ == 0)
+            __atomic_add_fetch(&started, 1, __ATOMIC_SEQ_CST);
+    }
+    return (void*)reads;
+}
+
+int main(void) {
+    symbols_handle_t* handle = symbols_handle_create(make_table(1));
+    assert(handle != NULL);
+
+    pthread_t readers[NUM_READERS];
+    for (int i = 0; i < NUM_READERS; i++) {
+        int rc = pthread_create(&readers[i], NULL, reader_thread, handle);
+        assert(rc == 0);
+    }
+
+    // Reload on the side, then swap
+    for (int gen = 2; gen <= NUM_RELOADS; gen++) {
+        symbol_table_t* table = make_table(gen);
+        bool published = symbols_handle_publish(handle, table);
+        assert(published);
+    }
+
+    // Wait until every reader has completed at least one read
+    while (__atomic_load_n(&started, __ATOMIC_SEQ_CST) < NUM_READERS)
+        sched_yield();
+    __atomic_store_n(&done, 1, __ATOMIC_SEQ_CST);
+    size_t total = 0;
+    for (int i = 0; i < NUM_READERS; i++) {
+        void* reads;
+        pthread_join(readers[i], &reads);
+        total += (size_t)reads;
+    }
+
+    symbols_reader_t reader;
+    const symbol_table_t* table = symbols_handle_read_begin(handle, &reader);
+    assert(table != NULL && symbols_is_frozen(table));
+    assert(table->entries[0].line == NUM_RELOADS);
+    symbols_handle_read_end(&reader);
+
+    symbols_handle_free(handle);
+    if (total == 0) {
+        fprintf(stderr, "No reads completed across %d reloads\n", NUM_RELOADS);
+        return 1;
+    }
+    printf("%zu reads across %d reloads\n", total, NUM_RELOADS);
+    printf("All handle tests passed\n");
+    return 0;
+}
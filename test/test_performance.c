@@ -8,6 +8,10 @@
 #define NUM_SYMBOLS 10000
 // Number of lookups to perform
 #define NUM_LOOKUPS 1000
+// Number of lookups for the layout comparison
+#define NUM_LAYOUT_LOOKUPS 2000000
+// Number of trace addresses for the batch symbolization benchmark
+#define NUM_TRACE_ADDRESSES 4000000
 
 // Helper function to generate random addresses
 static uint16_t random_address(void) {
@@ -22,6 +26,103 @@ static double measure_lookup_time(const symbol_table_t* table, uint16_t address)
     return (double)(end - start) / CLOCKS_PER_SEC;
 }
 
+// Address lookup directly on the symbol_entry_t array, as the library did
+// before it kept a packed address array
+static const symbol_entry_t* entry_array_lookup(const symbol_table_t* table, uint16_t address) {
+    size_t lo = 0, hi = table->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (table->entries[mid].address < address)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo < table->count && table->entries[lo].address == address ? &table->entries[lo] : NULL;
+}
+
+// Compare lookups over the packed layout with lookups over the entries
+static void compare_layouts(const symbol_table_t* table) {
+    uint16_t* addresses = malloc(NUM_LAYOUT_LOOKUPS * sizeof(uint16_t));
+    assert(addresses != NULL);
+    for (int i = 0; i < NUM_LAYOUT_LOOKUPS; i++) {
+        addresses[i] = random_address();
+    }
+
+    size_t found_entries = 0, found_packed = 0;
+
+    clock_t start = clock();
+    for (int i = 0; i < NUM_LAYOUT_LOOKUPS; i++) {
+        found_entries += entry_array_lookup(table, addresses[i]) != NULL;
+    }
+    double entries_time = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (int i = 0; i < NUM_LAYOUT_LOOKUPS; i++) {
+        found_packed += symbols_lookup_by_address(table, addresses[i]) != NULL;
+    }
+    double packed_time = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    for (int i = 0; i < NUM_LOOKUPS; i++) {
+        assert(symbols_lookup_by_address(table, addresses[i]) == entry_array_lookup(table, addresses[i]));
+    }
+    assert(found_entries == found_packed);
+
+    printf("Layout comparison (%d lookups, %zu entries):\n", NUM_LAYOUT_LOOKUPS, table->count);
+    printf("  Entry array:   %.1f ns per lookup\n", entries_time * 1e9 / NUM_LAYOUT_LOOKUPS);
+    printf("  Packed arrays: %.1f ns per lookup\n", packed_time * 1e9 / NUM_LAYOUT_LOOKUPS);
+    if (packed_time > 0)
+        printf("  Packed layout is %.2fx faster\n", entries_time / packed_time);
+
+    free(addresses);
+}
+
+// Symbolize a trace one address at a time and in batches
+static void compare_batch_resolution(void) {
+    symbol_table_t* table = symbols_create();
+    assert(table != NULL);
+    uint16_t address = 0100;
+    for (int i = 0; i < 4000; i++) {
+        assert(symbols_add_entry(table, i % 7 ? "main.c" : "util.c", NULL, i + 1, address, SYMBOL_TYPE_LINE));
+        address += 1 + rand() % 6;
+    }
+    symbols_sort_by_address(table);
+
+    uint16_t* trace = malloc(NUM_TRACE_ADDRESSES * sizeof(uint16_t));
+    symbol_location_t* out = malloc(NUM_TRACE_ADDRESSES * sizeof(symbol_location_t));
+    assert(trace && out);
+    for (int i = 0; i < NUM_TRACE_ADDRESSES; i++) {
+        trace[i] = (uint16_t)(0100 + rand() % (address - 0100));
+    }
+
+    clock_t start = clock();
+    for (int i = 0; i < NUM_TRACE_ADDRESSES; i++) {
+        out[i].filename = symbols_get_file(table, trace[i]);
+        out[i].line = symbols_get_line(table, trace[i]);
+    }
+    double single_time = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    assert(symbols_resolve_batch(table, trace, NUM_TRACE_ADDRESSES, out));
+    double batch_time = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    // clock() adds up CPU time over threads, so time the threaded run by wall clock
+    struct timespec wall_start, wall_end;
+    timespec_get(&wall_start, TIME_UTC);
+    assert(symbols_resolve_batch_threaded(table, trace, NUM_TRACE_ADDRESSES, out, 4));
+    timespec_get(&wall_end, TIME_UTC);
+    double threaded_time = (double)(wall_end.tv_sec - wall_start.tv_sec) +
+                           (double)(wall_end.tv_nsec - wall_start.tv_nsec) / 1e9;
+
+    printf("Batch symbolization (%d addresses, %zu line entries):\n", NUM_TRACE_ADDRESSES, table->count);
+    printf("  Per address:      %.1f ns per address\n", single_time * 1e9 / NUM_TRACE_ADDRESSES);
+    printf("  Batch:            %.1f ns per address\n", batch_time * 1e9 / NUM_TRACE_ADDRESSES);
+    printf("  Batch, 4 threads: %.1f ns per address\n", threaded_time * 1e9 / NUM_TRACE_ADDRESSES);
+
+    free(trace);
+    free(out);
+    symbols_free(table);
+}
+
 int main(void) {
     // Initialize random number generator
     srand(time(NULL));
@@ -60,7 +161,7 @@ int main(void) {
 
     // Sort entries for binary search
     printf("Sorting entries for binary search...\n");
-    qsort(table->entries, table->count, sizeof(symbol_entry_t), compare_entries_by_address);
+    symbols_sort_by_address(table);
 
     // Test binary search
     printf("Testing binary search...\n");
@@ -73,7 +174,11 @@ int main(void) {
 
     // Calculate speedup
     double speedup = linear_total / binary_total;
-    printf("Binary search is %.2fx faster than linear search\n", speedup);
+    printf("Binary search is %.2fx faster than linear search\n\n", speedup);
+
+    compare_layouts(table);
+    printf("\n");
+    compare_batch_resolution();
 
     // Cleanup
     free(addresses);
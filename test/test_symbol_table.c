@@ -0,0 +1,1464 @@
+// The checks below call the functions under test; keep them in release builds
+#undef NDEBUG
+
+#include "../include/symbols.h"
+#include "../include/mapfile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+// Number of random symbols used by the consistency checks
+#define NUM_SYMBOLS 5000
+
+// Number of entries in the generated line tables
+#define NUM_LINES 1500
+
+// Merge-on-add: same (address, type) updates missing fields, first value wins
+static void test_merge_semantics(void)
+{
+    symbol_table_t* table = symbols_create();
+    assert(table != NULL);
+
+    assert(symbols_add_entry(table, NULL, "main", 0, 0100, SYMBOL_TYPE_FUNCTION));
+    assert(symbols_add_entry(table, "main.c", "other", 12, 0100, SYMBOL_TYPE_FUNCTION));
+    assert(symbols_add_entry(table, "main.c", "main", 0, 0100, SYMBOL_TYPE_VARIABLE));
+    assert(table->count == 2);
+
+    const symbol_entry_t* fn = &table->entries[0];
+    assert(strcmp(fn->name, "main") == 0);
+    assert(strcmp(fn->filename, "main.c") == 0);
+    assert(fn->line == 12);
+
+    // LINE and FILE entries are never merged
+    assert(symbols_add_entry(table, "main.c", NULL, 3, 0100, SYMBOL_TYPE_LINE));
+    assert(symbols_add_entry(table, "main.c", NULL, 4, 0100, SYMBOL_TYPE_LINE));
+    assert(symbols_add_entry(table, "a.c", NULL, 0, 0, SYMBOL_TYPE_FILE));
+    assert(symbols_add_entry(table, "b.c", NULL, 0, 0, SYMBOL_TYPE_FILE));
+    assert(table->count == 6);
+
+    // Sorting reorders entries; merging must still find the original
+    symbols_sort_by_address(table);
+    assert(symbols_add_entry(table, NULL, "late", 0, 0100, SYMBOL_TYPE_VARIABLE));
+    assert(table->count == 6);
+
+    symbols_free(table);
+    printf("merge semantics: ok\n");
+}
+
+// Random adds must produce exactly one entry per mergeable (address, type)
+static void test_merge_random(void)
+{
+    symbol_table_t* table = symbols_create();
+    assert(table != NULL);
+
+    static unsigned char seen[0x10000][SYMBOL_TYPE_LINE + 1];
+    size_t expected = 0;
+    memset(seen, 0, sizeof(seen));
+
+    for (int i = 0; i < NUM_SYMBOLS; i++) {
+        char name[32];
+        uint16_t address = (uint16_t)(rand() % 2048);
+        symbol_type_t type = (symbol_type_t)(rand() % (SYMBOL_TYPE_LINE + 1));
+        snprintf(name, sizeof(name), "sym_%d", i);
+
+        assert(symbols_add_entry(table, "rand.c", name, i, address, type));
+        if (type == SYMBOL_TYPE_LINE || type == SYMBOL_TYPE_FILE || !seen[address][type])
+            expected++;
+        seen[address][type] = 1;
+
+        if (i == NUM_SYMBOLS / 2)
+            symbols_sort_by_address(table);
+    }
+    assert(table->count == expected);
+
+    // Strings are interned: one copy per distinct name plus the filename
+    symbol_arena_stats_t stats;
+    symbols_get_arena_stats(table, &stats);
+    assert(stats.blocks > 0);
+    assert(stats.bytes_used > 0 && stats.bytes_used <= stats.bytes_reserved);
+
+    symbols_free(table);
+    printf("merge random: ok (%zu entries)\n", expected);
+}
+
+// Bulk ingestion must produce the same entries as adding one at a time
+static void test_bulk_matches_single(void)
+{
+    symbol_table_t* single = symbols_create();
+    symbol_table_t* bulk = symbols_create();
+    assert(single != NULL && bulk != NULL);
+
+    static const char* files[] = { "a.c", "b.c", NULL };
+    symbol_entry_t* batch = malloc(NUM_SYMBOLS * sizeof(symbol_entry_t));
+    char (*names)[32] = malloc(NUM_SYMBOLS * sizeof(*names));
+    assert(batch != NULL && names != NULL);
+
+    for (int i = 0; i < NUM_SYMBOLS; i++) {
+        snprintf(names[i], sizeof(names[i]), "sym_%d", i);
+        batch[i].filename = files[rand() % 3];
+        batch[i].name = (rand() % 4) ? names[i] : NULL;
+        batch[i].line = rand() % 3;
+        batch[i].address = (uint16_t)(rand() % 1024);
+        batch[i].type = (symbol_type_t)(rand() % (SYMBOL_TYPE_LINE + 1));
+        batch[i].desc = 0;
+        batch[i].owns_strings = false;
+
+        assert(symbols_add_entry(single, batch[i].filename, batch[i].name,
+                                 batch[i].line, batch[i].address, batch[i].type));
+    }
+
+    // Two batches exercise merging against entries already in the table
+    assert(symbols_add_entries_bulk(bulk, batch, NUM_SYMBOLS / 2));
+    assert(symbols_add_entries_bulk(bulk, batch + NUM_SYMBOLS / 2, NUM_SYMBOLS - NUM_SYMBOLS / 2));
+    assert(single->count == bulk->count);
+
+    for (size_t i = 1; i < bulk->count; i++)
+        assert(bulk->entries[i - 1].address <= bulk->entries[i].address);
+
+    // Every merged entry must carry the same fields as the incremental one
+    for (size_t i = 0; i < bulk->count; i++) {
+        const symbol_entry_t* b = &bulk->entries[i];
+        if (b->type == SYMBOL_TYPE_LINE || b->type == SYMBOL_TYPE_FILE)
+            continue;
+
+        const symbol_entry_t* s = NULL;
+        for (size_t j = 0; j < single->count && !s; j++) {
+            if (single->entries[j].address == b->address && single->entries[j].type == b->type)
+                s = &single->entries[j];
+        }
+        assert(s != NULL);
+        assert(s->line == b->line);
+        assert((s->name == NULL) == (b->name == NULL));
+        assert(!s->name || strcmp(s->name, b->name) == 0);
+        assert((s->filename == NULL) == (b->filename == NULL));
+        assert(!s->filename || strcmp(s->filename, b->filename) == 0);
+    }
+
+    free(names);
+    free(batch);
+    symbols_free(single);
+    symbols_free(bulk);
+    printf("bulk matches single: ok\n");
+}
+
+// Name lookups return the first entry in table order, then each duplicate
+static void test_name_lookup(void)
+{
+    symbol_table_t* table = symbols_create();
+    assert(table != NULL);
+
+    for (int i = 0; i < NUM_SYMBOLS; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "sym_%d", rand() % (NUM_SYMBOLS / 4));
+        assert(symbols_add_entry(table, "names.c", name, 0, (uint16_t)i, SYMBOL_TYPE_VARIABLE));
+    }
+    symbols_sort_by_address(table);
+
+    for (int n = 0; n < NUM_SYMBOLS / 4; n++) {
+        char name[32];
+        snprintf(name, sizeof(name), "sym_%d", n);
+
+        // Collect the expected positions with a linear scan
+        size_t expected = 0;
+        const symbol_entry_t* e = symbols_lookup_by_name(table, name);
+        for (size_t i = 0; i < table->count; i++) {
+            if (strcmp(table->entries[i].name, name) != 0)
+                continue;
+            assert(e == &table->entries[i]);
+            e = symbols_lookup_next_by_name(table, e);
+            expected++;
+        }
+        assert(e == NULL);
+        if (expected == 0)
+            assert(symbols_lookup_by_name(table, name) == NULL);
+    }
+    assert(symbols_lookup_by_name(table, "missing") == NULL);
+
+    // Adding invalidates the index
+    assert(symbols_add_entry(table, "names.c", "fresh", 0, 0177777, SYMBOL_TYPE_FUNCTION));
+    assert(symbols_lookup_by_name(table, "fresh") != NULL);
+
+    symbols_free(table);
+    printf("name lookup: ok\n");
+}
+
+// Fill a table with interleaved LINE entries from a few files, plus FILE
+// and FUNCTION entries, the way a map file load does
+static void fill_line_table(symbol_table_t* table)
+{
+    static const char* files[] = { "hello.c", "/src/util.c", "lib/math.c" };
+    symbol_entry_t* batch = malloc(NUM_LINES * sizeof(symbol_entry_t));
+    assert(batch != NULL);
+
+    uint16_t address = 0100;
+    for (int i = 0; i < NUM_LINES; i++) {
+        memset(&batch[i], 0, sizeof(batch[i]));
+        batch[i].filename = files[(i / 40 + (rand() % 10 == 0)) % 3];
+        batch[i].line = 1 + (i % 40) * 2 + rand() % 3;
+        batch[i].address = address;
+        batch[i].type = SYMBOL_TYPE_LINE;
+        if (i % 50 == 0)
+            batch[i].type = SYMBOL_TYPE_FUNCTION;
+        if (i % 40 == 0) {
+            batch[i].type = SYMBOL_TYPE_FILE;
+            batch[i].address = 0;
+        }
+        address += rand() % 4;
+    }
+    assert(symbols_add_entries_bulk(table, batch, NUM_LINES));
+    free(batch);
+}
+
+// The line index must give the same answers as the floor scan
+static void test_line_index(void)
+{
+    symbol_table_t* plain = symbols_create();
+    symbol_table_t* indexed = symbols_create();
+    assert(plain != NULL && indexed != NULL);
+
+    unsigned seed = (unsigned)rand();
+    srand(seed);
+    fill_line_table(plain);
+    srand(seed);
+    assert(symbols_set_line_index(indexed, true));
+    fill_line_table(indexed);
+
+    for (uint32_t a = 0; a < 0x10000; a++) {
+        const char* fp = symbols_get_file(plain, (uint16_t)a);
+        const char* fi = symbols_get_file(indexed, (uint16_t)a);
+        assert((fp == NULL) == (fi == NULL));
+        assert(!fp || strcmp(fp, fi) == 0);
+        assert(symbols_get_line(plain, (uint16_t)a) == symbols_get_line(indexed, (uint16_t)a));
+        assert(symbols_get_next_line_address(plain, (uint16_t)a) ==
+               symbols_get_next_line_address(indexed, (uint16_t)a));
+
+        // Stepping: next higher LINE address in the same file
+        if (a % 7 == 0) {
+            uint16_t expected = 0;
+            for (size_t i = 0; fp && i < plain->count && !expected; i++) {
+                const symbol_entry_t* e = &plain->entries[i];
+                if (e->type == SYMBOL_TYPE_LINE && e->filename == fp && e->address > a)
+                    expected = e->address;
+            }
+            assert(symbols_get_next_line_address(plain, (uint16_t)a) == expected);
+        }
+    }
+
+    symbols_free(plain);
+    symbols_free(indexed);
+    printf("line index: ok\n");
+}
+
+static bool count_entry(const symbol_entry_t* entry, void* user_data)
+{
+    (void)entry;
+    (*(size_t*)user_data)++;
+    return true;
+}
+
+// Floor and range lookups against a linear scan of the sorted table
+static void test_floor_and_range(void)
+{
+    symbol_table_t* table = symbols_create();
+    assert(table != NULL);
+    fill_line_table(table);
+
+    static const unsigned masks[] = {
+        SYMBOL_TYPE_MASK(SYMBOL_TYPE_LINE),
+        SYMBOL_TYPE_MASK(SYMBOL_TYPE_FUNCTION),
+        SYMBOL_TYPE_MASK(SYMBOL_TYPE_FUNCTION) | SYMBOL_TYPE_MASK(SYMBOL_TYPE_FILE),
+        SYMBOL_TYPE_MASK(SYMBOL_TYPE_FUNCTION) | SYMBOL_TYPE_MASK(SYMBOL_TYPE_LINE),
+        SYMBOL_TYPE_MASK(SYMBOL_TYPE_VARIABLE),
+        SYMBOL_TYPE_MASK_ALL,
+    };
+    const size_t mask_count = sizeof(masks) / sizeof(masks[0]);
+
+    // Canonical order: address, then type, then line
+    for (size_t i = 1; i < table->count; i++) {
+        const symbol_entry_t* a = &table->entries[i - 1];
+        const symbol_entry_t* b = &table->entries[i];
+        assert(a->address < b->address ||
+               (a->address == b->address && (a->type < b->type ||
+                (a->type == b->type && a->line <= b->line))));
+    }
+
+    for (int n = 0; n < 2000; n++) {
+        uint16_t address = (uint16_t)(rand() % 0x3000);
+        unsigned mask = masks[n % mask_count];
+
+        const symbol_entry_t* expected = NULL;
+        for (size_t i = 0; i < table->count && table->entries[i].address <= address; i++) {
+            if (mask & SYMBOL_TYPE_MASK(table->entries[i].type))
+                expected = &table->entries[i];
+        }
+        assert(symbols_lookup_floor(table, address, mask) == expected);
+
+        const symbol_entry_t* exact = symbols_lookup_by_address(table, address);
+        assert(!exact || exact->address == address);
+        assert(!exact || exact == table->entries || exact[-1].address < address);
+
+        uint16_t hi = (uint16_t)(address + rand() % 64);
+        size_t in_range = 0, visited = 0;
+        for (size_t i = 0; i < table->count; i++) {
+            if (table->entries[i].address >= address && table->entries[i].address <= hi)
+                in_range++;
+        }
+        assert(symbols_lookup_range(table, address, hi, count_entry, &visited) == in_range);
+        assert(visited == in_range);
+    }
+
+    // Types outside symbol_type_t have no partition of their own
+    assert(symbols_add_entry(table, "odd.c", "odd", 0, 0200, (symbol_type_t)9));
+    symbols_sort_by_address(table);
+    for (int n = 0; n < 600; n++) {
+        uint16_t address = (uint16_t)(rand() % 0400);
+        unsigned mask = n % 3 == 0 ? SYMBOL_TYPE_MASK(9) : masks[n % mask_count] | (n % 3 == 1 ? SYMBOL_TYPE_MASK(9) : 0);
+
+        const symbol_entry_t* expected = NULL;
+        for (size_t i = 0; i < table->count && table->entries[i].address <= address; i++) {
+            if (mask & SYMBOL_TYPE_MASK(table->entries[i].type))
+                expected = &table->entries[i];
+        }
+        assert(symbols_lookup_floor(table, address, mask) == expected);
+    }
+
+    symbols_free(table);
+    printf("floor and range: ok\n");
+}
+
+// Breakpoint resolution: closest line in the file, first entry on ties
+static void test_find_address(void)
+{
+    symbol_table_t* table = symbols_create();
+    assert(table != NULL);
+    fill_line_table(table);
+
+    static const char* requests[] = { "hello.c", "/home/me/hello.c", "util.c", "lib/math.c", "none.c" };
+    for (size_t r = 0; r < sizeof(requests) / sizeof(requests[0]); r++) {
+        for (int line = -5; line < 120; line++) {
+            uint16_t address = 0, diff = 0;
+            bool found = symbols_find_address(table, requests[r], &address, &diff, line);
+            if (r == 4) {
+                assert(!found);
+                continue;
+            }
+            assert(found);
+
+            // The file entry is the first FILE entry matching by path or basename
+            const char* base = strrchr(requests[r], '/');
+            base = base ? base + 1 : requests[r];
+            const char* file = NULL;
+            for (size_t i = 0; i < table->count && !file; i++) {
+                const char* f = table->entries[i].filename;
+                const char* fb = f ? strrchr(f, '/') : NULL;
+                fb = fb ? fb + 1 : f;
+                if (table->entries[i].type == SYMBOL_TYPE_FILE && f &&
+                    (strcmp(f, requests[r]) == 0 || strcmp(fb, base) == 0))
+                    file = f;
+            }
+            assert(file != NULL);
+
+            int best = -1, best_diff = 0;
+            for (size_t i = 0; i < table->count; i++) {
+                const symbol_entry_t* e = &table->entries[i];
+                if (e->type != SYMBOL_TYPE_LINE || !e->filename || strcmp(e->filename, file) != 0)
+                    continue;
+                int d = abs(e->line - line);
+                if (best < 0 || d < best_diff) {
+                    best = (int)i;
+                    best_diff = d;
+                }
+            }
+            assert(best >= 0);
+            assert(address == table->entries[best].address);
+            assert(diff == (uint16_t)best_diff);
+        }
+    }
+
+    symbols_free(table);
+    printf("find address: ok\n");
+}
+
+// Address search on both sides of the small-table cutoff, with duplicate
+// addresses and the ends of the address space
+static void test_address_search(void)
+{
+    static const size_t sizes[] = { 1, 7, 8, 9, 63, 64, 65, 100, 1000 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        symbol_table_t* table = symbols_create();
+        assert(table != NULL);
+        for (size_t i = 0; i < sizes[s]; i++) {
+            uint16_t address = i == 0 ? 0 : i == 1 ? 0xFFFF : (uint16_t)(rand() % 0x400);
+            assert(symbols_add_entry(table, "a.c", NULL, (int)i, address, SYMBOL_TYPE_LINE));
+        }
+        symbols_sort_by_address(table);
+
+        for (uint32_t q = 0; q <= 0xFFFF; q += (q < 0x410 ? 1 : 0x3FF)) {
+            uint16_t address = (uint16_t)q;
+            const symbol_entry_t* first = NULL;
+            const symbol_entry_t* floor = NULL;
+            for (size_t i = 0; i < table->count; i++) {
+                if (!first && table->entries[i].address == address)
+                    first = &table->entries[i];
+                if (table->entries[i].address <= address)
+                    floor = &table->entries[i];
+            }
+            assert(symbols_lookup_by_address(table, address) == first);
+            assert(symbols_lookup_floor(table, address, SYMBOL_TYPE_MASK_ALL) == floor);
+        }
+        assert(symbols_lookup_floor(table, 0xFFFF, SYMBOL_TYPE_MASK_ALL) == &table->entries[table->count - 1]);
+
+        symbols_free(table);
+    }
+    printf("address search: ok\n");
+}
+
+// Queries give the same answers after freezing, and mutations are rejected
+static void test_freeze(void)
+{
+    symbol_table_t* table = symbols_create();
+    assert(table != NULL);
+    fill_line_table(table);
+    assert(symbols_add_entry(table, NULL, "late", 0, 0050, SYMBOL_TYPE_FUNCTION));
+    assert(!symbols_is_frozen(table));
+
+    enum { SAMPLES = 0x3000 };
+    int* lines = malloc(SAMPLES * sizeof(int));
+    uint16_t* next = malloc(SAMPLES * sizeof(uint16_t));
+    uint16_t* function = malloc(SAMPLES * sizeof(uint16_t));
+    assert(lines && next && function);
+
+    symbols_sort_by_address(table);
+    for (uint16_t a = 0; a < SAMPLES; a++) {
+        const symbol_entry_t* f = symbols_lookup_floor(table, a, SYMBOL_TYPE_MASK(SYMBOL_TYPE_FUNCTION));
+        lines[a] = symbols_get_line(table, a);
+        next[a] = symbols_get_next_line_address(table, a);
+        function[a] = f ? f->address : 0xFFFF;
+    }
+    uint16_t before_address = 0, before_diff = 0;
+    assert(symbols_find_address(table, "util.c", &before_address, &before_diff, 17));
+
+    assert(symbols_freeze(table));
+    assert(symbols_is_frozen(table));
+    assert(table->capacity == table->count);
+
+    for (uint16_t a = 0; a < SAMPLES; a++) {
+        const symbol_entry_t* f = symbols_lookup_floor(table, a, SYMBOL_TYPE_MASK(SYMBOL_TYPE_FUNCTION));
+        assert(symbols_get_line(table, a) == lines[a]);
+        assert(symbols_get_next_line_address(table, a) == next[a]);
+        assert((f ? f->address : 0xFFFF) == function[a]);
+    }
+    uint16_t address = 0, diff = 0;
+    assert(symbols_find_address(table, "util.c", &address, &diff, 17));
+    assert(address == before_address && diff == before_diff);
+    assert(symbols_lookup_by_name(table, "late") != NULL);
+
+    size_t count = table->count;
+    symbol_entry_t entry = { 0 };
+    entry.type = SYMBOL_TYPE_LINE;
+    assert(!symbols_add_entry(table, "x.c", NULL, 1, 0, SYMBOL_TYPE_LINE));
+    assert(!symbols_add_entries_bulk(table, &entry, 1));
+    assert(!symbols_load_map(table, "does-not-matter.map"));
+    assert(!symbols_set_line_index(table, true));
+    assert(symbols_set_line_index(table, false));
+    assert(table->count == count);
+
+    free(lines);
+    free(next);
+    free(function);
+    symbols_free(table);
+    printf("freeze: ok\n");
+}
+
+// Batches resolve like symbols_get_file()/symbols_get_line(), on every path
+static void test_resolve_batch(void)
+{
+    symbol_table_t* table = symbols_create();
+    assert(table != NULL);
+    fill_line_table(table);
+
+    size_t max = (size_t)1 << 19;
+    uint16_t* addrs = malloc(max * sizeof(uint16_t));
+    symbol_location_t* out = malloc(max * sizeof(symbol_location_t));
+    assert(addrs && out);
+    for (size_t i = 0; i < max; i++)
+        addrs[i] = (uint16_t)(rand() % 0x3000);
+
+    static const size_t counts[] = { 0, 100, 10000, (size_t)1 << 19 };
+    for (int indexed = 0; indexed < 2; indexed++) {
+        assert(symbols_set_line_index(table, indexed != 0));
+        for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+            for (unsigned threads = 1; threads <= 4; threads += 3) {
+                memset(out, 0xAA, max * sizeof(symbol_location_t));
+                assert(symbols_resolve_batch_threaded(table, addrs, counts[c], out, threads));
+                for (size_t i = 0; i < counts[c]; i++) {
+                    assert(out[i].filename == symbols_get_file(table, addrs[i]));
+                    assert(out[i].line == symbols_get_line(table, addrs[i]));
+                }
+            }
+        }
+    }
+    assert(!symbols_resolve_batch(table, NULL, 1, out));
+
+    free(addrs);
+    free(out);
+    symbols_free(table);
+    printf("resolve batch: ok\n");
+}
+
+// Function lookup without the cache: the smallest enclosing function
+static symbol_function_t* find_function_reference(symbol_debug_info_t* info, uint16_t address)
+{
+    symbol_function_t* best = NULL;
+    unsigned best_range = 0;
+    for (int i = 0; i < info->function_count; i++) {
+        symbol_function_t* fn = &info->functions[i];
+        if (address < fn->start_address || address > fn->end_address)
+            continue;
+        unsigned range = fn->end_address == 0xFFFF ? 0xFFFE : (unsigned)(fn->end_address - fn->start_address);
+        if (!best || range < best_range) {
+            best = fn;
+            best_range = range;
+        }
+    }
+    return best;
+}
+
+// Repeated lookups hit the per-thread caches and give uncached answers
+static void test_lookup_cache(void)
+{
+    // Two copies of one table; the line index bypasses the cache
+    symbol_table_t* table = symbols_create();
+    symbol_table_t* indexed = symbols_create();
+    assert(table != NULL && indexed != NULL);
+    srand(7);
+    fill_line_table(table);
+    srand(7);
+    fill_line_table(indexed);
+    assert(symbols_set_line_index(indexed, true));
+
+    // Stepping forward mostly hits
+    symbol_cache_stats_t stats;
+    symbols_reset_cache_stats();
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 1) {
+            symbols_get_cache_stats(&stats);
+            assert(stats.source_hits > stats.source_misses * 2);
+        }
+        for (unsigned n = 0; n < 0x3000; n++) {
+            uint16_t a = pass == 0 ? (uint16_t)n : (uint16_t)(rand() % 0x3000);
+            assert(symbols_get_line(table, a) == symbols_get_line(indexed, a));
+            const char* file = symbols_get_file(table, a);
+            const char* indexed_file = symbols_get_file(indexed, a);
+            assert(file ? indexed_file && strcmp(file, indexed_file) == 0 : !indexed_file);
+            assert(symbols_get_next_line_address(table, a) == symbols_get_next_line_address(indexed, a));
+        }
+    }
+    symbols_free(indexed);
+
+    // Changing the table drops its cached ranges
+    uint16_t last = table->entries[table->count - 1].address;
+    int before = symbols_get_line(table, (uint16_t)(last + 1));
+    assert(symbols_add_entry(table, "hello.c", NULL, 9999, (uint16_t)(last + 1), SYMBOL_TYPE_LINE));
+    symbols_sort_by_address(table);
+    assert(symbols_get_line(table, (uint16_t)(last + 1)) == 9999 && before != 9999);
+    symbols_free(table);
+
+    // Function ranges, nested and overlapping
+    symbol_debug_info_t* info = symbols_debug_info_create();
+    assert(info != NULL);
+    info->function_count = info->function_capacity = 40;
+    info->functions = calloc(40, sizeof(symbol_function_t));
+    assert(info->functions != NULL);
+    for (int i = 0; i < 40; i++) {
+        info->functions[i].start_address = (uint16_t)(rand() % 0x1000);
+        info->functions[i].end_address = (uint16_t)(info->functions[i].start_address + rand() % 0x200);
+    }
+    info->functions[7].end_address = 0xFFFF;
+
+    symbols_reset_cache_stats();
+    for (int pass = 0; pass < 2; pass++) {
+        for (unsigned n = 0; n < 0x1400; n++) {
+            uint16_t a = pass == 0 ? (uint16_t)n : (uint16_t)(rand() % 0x1400);
+            assert(symbols_find_function_at(info, a) == find_function_reference(info, a));
+        }
+    }
+    symbols_get_cache_stats(&stats);
+    assert(stats.function_hits > 0x1000 && stats.function_misses > 0);
+    symbols_debug_info_free(info);
+
+    printf("lookup cache: ok\n");
+}
+
+// Completion returns distinct names with the prefix, in strcmp order
+static void test_completion(void)
+{
+    symbol_table_t* table = symbols_create();
+    assert(table != NULL);
+    static const char* names[] = { "_summary", "_sum", "_sub", "sum", "_sum2", "_sum", "_s", "_t" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+        assert(symbols_add_entry(table, NULL, names[i], 0, (uint16_t)(0100 + i), SYMBOL_TYPE_VARIABLE));
+    symbols_sort_by_address(table);
+
+    const char* out[8];
+    assert(symbols_complete_name(table, "_sum", out, 8) == 3);
+    assert(strcmp(out[0], "_sum") == 0 && strcmp(out[1], "_sum2") == 0 && strcmp(out[2], "_summary") == 0);
+    assert(symbols_complete_name(table, "_sum", out, 2) == 2);
+    assert(symbols_complete_name(table, "_s", out, 8) == 5);
+    assert(strcmp(out[0], "_s") == 0 && strcmp(out[1], "_sub") == 0);
+    assert(symbols_complete_name(table, "", out, 8) == 7);
+    assert(symbols_complete_name(table, "_u", out, 8) == 0);
+    assert(symbols_complete_name(table, "~", out, 8) == 0);
+    symbols_free(table);
+
+    symbol_debug_info_t* info = symbols_debug_info_create();
+    assert(info != NULL);
+    info->function_count = info->function_capacity = 4;
+    info->functions = calloc(4, sizeof(symbol_function_t));
+    assert(info->functions != NULL);
+    static char fnames[4][8] = { "main", "sum", "sub", "summa" };
+    for (int i = 0; i < 4; i++)
+        info->functions[i].name = fnames[i];
+
+    symbol_function_t* fns[4];
+    assert(symbols_complete_function(info, "su", fns, 4) == 3);
+    assert(fns[0] == &info->functions[2] && fns[1] == &info->functions[1] && fns[2] == &info->functions[3]);
+    assert(symbols_complete_function(info, "m", fns, 4) == 1 && fns[0] == &info->functions[0]);
+    symbols_debug_info_free(info);
+
+    printf("completion: ok\n");
+}
+
+typedef struct {
+    const char* names[16];
+    symbol_match_t matches[16];
+    size_t count;
+    size_t limit;
+} search_result_t;
+
+static bool collect_match(const symbol_entry_t* entry, symbol_match_t match, void* user_data)
+{
+    search_result_t* result = user_data;
+    result->names[result->count] = entry->name;
+    result->matches[result->count] = match;
+    result->count++;
+    return result->count < result->limit;
+}
+
+static size_t run_search(symbol_table_t* table, const char* pattern, unsigned flags, search_result_t* result)
+{
+    memset(result, 0, sizeof(*result));
+    result->limit = 16;
+    size_t count = symbols_search(table, pattern, flags, collect_match, result);
+    assert(count == result->count);
+    return count;
+}
+
+// Search ranks exact, prefix and substring matches, then sorts by name
+static void test_search(void)
+{
+    symbol_table_t* table = symbols_create();
+    assert(table != NULL);
+    static const char* names[] = { "checksum", "sum", "_sum", "Sum", "summary", "SUMMARY", "sub", "sum", "res" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+        assert(symbols_add_entry(table, "a.c", names[i], 0, (uint16_t)(0100 + i), SYMBOL_TYPE_FUNCTION));
+    symbols_sort_by_address(table);
+
+    search_result_t r;
+    assert(run_search(table, "sum", 0, &r) == 4);
+    assert(strcmp(r.names[0], "sum") == 0 && r.matches[0] == SYMBOL_MATCH_EXACT);
+    assert(strcmp(r.names[1], "summary") == 0 && r.matches[1] == SYMBOL_MATCH_PREFIX);
+    assert(strcmp(r.names[2], "_sum") == 0 && r.matches[2] == SYMBOL_MATCH_SUBSTRING);
+    assert(strcmp(r.names[3], "checksum") == 0 && r.matches[3] == SYMBOL_MATCH_SUBSTRING);
+    assert(symbols_lookup_by_name(table, "sum") == symbols_lookup_by_name(table, r.names[0]));
+
+    assert(run_search(table, "SUM", SYMBOL_SEARCH_IGNORE_CASE, &r) == 6);
+    assert(r.matches[0] == SYMBOL_MATCH_EXACT && r.matches[1] == SYMBOL_MATCH_EXACT);
+    assert(strcmp(r.names[0], "Sum") == 0 && strcmp(r.names[1], "sum") == 0);
+    assert(strcmp(r.names[2], "SUMMARY") == 0 && r.matches[3] == SYMBOL_MATCH_PREFIX);
+
+    assert(run_search(table, "^s.b$|mar", SYMBOL_SEARCH_REGEX, &r) == 2);
+    assert(strcmp(r.names[0], "sub") == 0 && r.matches[0] == SYMBOL_MATCH_EXACT);
+    assert(strcmp(r.names[1], "summary") == 0 && r.matches[1] == SYMBOL_MATCH_SUBSTRING);
+    assert(run_search(table, "s.m", SYMBOL_SEARCH_REGEX | SYMBOL_SEARCH_IGNORE_CASE, &r) == 6);
+
+    assert(run_search(table, "", 0, &r) == 8);
+    assert(run_search(table, "summaryx", 0, &r) == 0);
+    assert(run_search(table, "(", SYMBOL_SEARCH_REGEX, &r) == 0);
+
+    memset(&r, 0, sizeof(r));
+    r.limit = 2;
+    assert(symbols_search(table, "u", 0, collect_match, &r) == 2);
+
+    symbols_free(table);
+    printf("search: ok\n");
+}
+
+static size_t memory_stats_sum(const symbol_memory_stats_t* stats)
+{
+    return stats->entry_bytes + stats->entry_slack_bytes + stats->variable_bytes +
+           stats->variable_slack_bytes + stats->string_bytes + stats->index_bytes +
+           stats->overhead_bytes;
+}
+
+// Memory stats add up, and count the strings and duplicates
+static void test_memory_stats(void)
+{
+    symbol_table_t* table = symbols_create();
+    assert(table != NULL);
+    static const char* names[] = { "main", "loop", "main", "x" };
+    for (size_t i = 0; i < 4; i++)
+        assert(symbols_add_entry(table, "f.c", names[i], 0, (uint16_t)(0100 + i), SYMBOL_TYPE_FUNCTION));
+
+    symbol_memory_stats_t stats;
+    symbols_get_memory_stats(table, &stats);
+    assert(stats.entry_bytes == 4 * sizeof(symbol_entry_t));
+    assert(stats.entry_bytes + stats.entry_slack_bytes == table->capacity * sizeof(symbol_entry_t));
+    assert(stats.string_count == 4 && stats.string_bytes == sizeof("f.c") + sizeof("main") + sizeof("loop") + sizeof("x"));
+    assert(stats.duplicate_strings == 4 && stats.duplicate_bytes == 3 * sizeof("f.c") + sizeof("main"));
+    assert(stats.variable_bytes == 0 && stats.total_bytes == memory_stats_sum(&stats));
+
+    // Lookup indices are counted once built
+    size_t index_bytes = stats.index_bytes;
+    assert(symbols_lookup_by_name(table, "loop") != NULL);
+    symbols_get_memory_stats(table, &stats);
+    assert(stats.index_bytes > index_bytes && stats.total_bytes == memory_stats_sum(&stats));
+    symbols_free(table);
+
+    // The file registry grows with the files, not with every name: only
+    // its map from pool ids (4 bytes per string) tracks the pool
+    symbol_table_t* with_files = symbols_create();
+    symbol_table_t* without_files = symbols_create();
+    assert(with_files != NULL && without_files != NULL);
+    for (int i = 0; i < 20000; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "n%d", i);
+        assert(symbols_add_entry(with_files, i % 2 ? "a.c" : "b.c", name, 0, (uint16_t)i, SYMBOL_TYPE_FUNCTION));
+        assert(symbols_add_entry(without_files, NULL, name, 0, (uint16_t)i, SYMBOL_TYPE_FUNCTION));
+    }
+    symbol_memory_stats_t without_stats;
+    symbols_get_memory_stats(with_files, &stats);
+    symbols_get_memory_stats(without_files, &without_stats);
+    assert(stats.index_bytes - without_stats.index_bytes <= 2 * 20002 * sizeof(uint32_t) + 1024);
+    symbols_free(with_files);
+    symbols_free(without_files);
+
+    // Debug info: 'f' has 10 variables, so its array grew from 8 to 16
+    char path[] = "/tmp/test_memory_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    FILE* f = fdopen(fd, "w");
+    assert(f != NULL);
+    fprintf(f, "FUNC:main -> 100\nPARAM:main:argc:int -> 4\nLOCAL:main:i:int -> -2\nFUNC:f -> 200\n");
+    for (int i = 0; i < 10; i++)
+        fprintf(f, "LOCAL:f:v%d:char* -> %d\n", i, -2 * i);
+    fclose(f);
+
+    symbol_debug_info_t* info = symbols_debug_info_create();
+    assert(info != NULL);
+    assert(symbols_load_srcmap_debug(info, path));
+    unlink(path);
+
+    symbols_debug_info_get_memory_stats(info, &stats);
+    assert(stats.entry_bytes == 2 * sizeof(symbol_function_t));
+    assert(stats.variable_bytes == 12 * sizeof(symbol_variable_t));
+    assert(stats.variable_slack_bytes == (6 + 6 + 8) * sizeof(symbol_variable_t));
+    assert(stats.string_count == 2 + 2 * 12);
+    assert(stats.duplicate_strings == 1 + 9 && stats.duplicate_bytes == sizeof("int") + 9 * sizeof("char*"));
+    assert(stats.index_bytes == 2 * (sizeof(symbol_function_t*) + sizeof(uint16_t)));
+    assert(stats.total_bytes == memory_stats_sum(&stats));
+
+    symbol_function_t* found[2];
+    assert(symbols_complete_function(info, "", found, 2) == 2);
+    symbols_debug_info_get_memory_stats(info, &stats);
+    assert(stats.index_bytes == 2 * (2 * sizeof(symbol_function_t*) + sizeof(uint16_t)));
+    assert(stats.total_bytes == memory_stats_sum(&stats));
+    symbols_debug_info_free(info);
+
+    printf("memory stats: ok\n");
+}
+
+// Loads record their phases only while a profile is attached
+static void test_load_profile(void)
+{
+    char path[] = "/tmp/test_profile_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    FILE* f = fdopen(fd, "w");
+    assert(f != NULL);
+    fprintf(f, "# generated\n");
+    for (int i = 0; i < 100; i++)
+        fprintf(f, "%s:%d -> %06o\n", i < 50 ? "a.c" : "b\\\"c.c", i + 1, 01000 + 2 * (i / 2));
+    long size = ftell(f);
+    fclose(f);
+
+    symbol_load_profile_t* profile = symbols_load_profile_create();
+    assert(profile != NULL);
+    assert(symbols_load_profile_attach(profile) == NULL);
+
+    symbol_table_t* table = symbols_create();
+    assert(table != NULL);
+    assert(symbols_load_map(table, path));
+
+    symbol_load_stats_t stats;
+    symbols_load_profile_get_stats(profile, &stats);
+    assert(stats.files_loaded == 1 && stats.bytes_read == (size_t)size);
+    assert(stats.lines_parsed == 101);
+    assert(stats.entries_added == 100 + 2 && stats.entries_merged == 0);
+    assert(stats.allocations > 0 && stats.load_ns > 0);
+    for (int phase = 0; phase < SYMBOL_LOAD_PHASE_COUNT; phase++)
+        assert(stats.phase_runs[phase] == 1 && stats.phase_ns[phase] <= stats.load_ns);
+
+    // Single adds count merges
+    assert(symbols_add_entry(table, "c.c", "f", 0, 01000, SYMBOL_TYPE_FUNCTION));
+    assert(symbols_add_entry(table, "c.c", "f", 0, 01000, SYMBOL_TYPE_FUNCTION));
+    symbols_load_profile_get_stats(profile, &stats);
+    assert(stats.entries_added == 104 && stats.entries_merged == 1);
+
+    char trace[] = "/tmp/test_trace_XXXXXX";
+    int trace_fd = mkstemp(trace);
+    assert(trace_fd >= 0);
+    close(trace_fd);
+    assert(symbols_load_profile_write_trace(profile, trace));
+    char text[4096];
+    f = fopen(trace, "r");
+    assert(f != NULL);
+    size_t length = fread(text, 1, sizeof(text) - 1, f);
+    text[length] = '\0';
+    fclose(f);
+    unlink(trace);
+    assert(strncmp(text, "{\"traceEvents\":[", 15) == 0);
+    assert(strstr(text, "\"name\":\"parse\"") && strstr(text, "\"name\":\"merge\"") && strstr(text, path));
+
+    // Detached: nothing more is recorded
+    assert(symbols_load_profile_attach(NULL) == profile);
+    assert(symbols_load_map(table, path));
+    symbol_load_stats_t after;
+    symbols_load_profile_get_stats(profile, &after);
+    assert(memcmp(&stats, &after, sizeof(stats)) == 0);
+
+    unlink(path);
+    symbols_free(table);
+    symbols_load_profile_free(profile);
+    printf("load profile: ok\n");
+}
+
+static uint64_t histogram_sum(const symbol_query_counter_t* counter)
+{
+    uint64_t sum = 0;
+    for (int b = 0; b < SYMBOL_QUERY_HISTOGRAM_BUCKETS; b++)
+        sum += counter->histogram[b];
+    return sum;
+}
+
+// Counts are per public call; a search's own name lookups do not count
+static void test_query_stats(void)
+{
+    symbol_table_t* table = symbols_create();
+    assert(table != NULL);
+    assert(symbols_add_entry(table, "a.c", "main", 0, 0x100, SYMBOL_TYPE_FUNCTION));
+    assert(symbols_add_entry(table, "a.c", "helper", 0, 0x120, SYMBOL_TYPE_FUNCTION));
+    assert(symbols_add_entry(table, "a.c", NULL, 3, 0x100, SYMBOL_TYPE_LINE));
+    symbols_sort_by_address(table);
+    assert(strcmp(symbols_query_name(SYMBOL_QUERY_GET_LINE), "symbols_get_line") == 0);
+    assert(symbols_query_name(SYMBOL_QUERY_COUNT) == NULL);
+
+    symbols_reset_query_stats();
+    for (int i = 0; i < 5; i++)
+        assert(symbols_lookup_by_address(table, 0x100) != NULL);
+    assert(symbols_get_line(table, 0x104) == 3);
+    search_result_t result;
+    assert(run_search(table, "e", 0, &result) == 1);
+
+    symbol_query_stats_t stats;
+    if (!symbols_get_query_stats(&stats))
+    {
+        // Built without SYMBOLS_QUERY_STATS
+        for (int q = 0; q < SYMBOL_QUERY_COUNT; q++)
+            assert(stats.queries[q].calls == 0);
+        symbols_free(table);
+        printf("query stats: ok (not compiled in)\n");
+        return;
+    }
+
+    const symbol_query_counter_t* by_address = &stats.queries[SYMBOL_QUERY_LOOKUP_BY_ADDRESS];
+    assert(by_address->calls == 5 && histogram_sum(by_address) == 5);
+    assert(stats.queries[SYMBOL_QUERY_GET_LINE].calls == 1);
+    assert(stats.queries[SYMBOL_QUERY_SEARCH].calls == 1);
+    assert(stats.queries[SYMBOL_QUERY_LOOKUP_BY_NAME].calls == 0);
+    assert(stats.queries[SYMBOL_QUERY_FIND_ADDRESS].calls == 0);
+    for (int q = 0; q < SYMBOL_QUERY_COUNT; q++)
+        assert(histogram_sum(&stats.queries[q]) == stats.queries[q].calls);
+
+    symbols_reset_query_stats();
+    assert(symbols_get_query_stats(&stats));
+    for (int q = 0; q < SYMBOL_QUERY_COUNT; q++)
+        assert(stats.queries[q].calls == 0 && stats.queries[q].total_ns == 0);
+
+    symbols_free(table);
+    printf("query stats: ok\n");
+}
+
+static unsigned char* read_file(const char* path, size_t* size)
+{
+    FILE* f = fopen(path, "rb");
+    assert(f != NULL);
+    fseek(f, 0, SEEK_END);
+    *size = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    unsigned char* data = malloc(*size ? *size : 1);
+    assert(data != NULL && fread(data, 1, *size, f) == *size);
+    fclose(f);
+    return data;
+}
+
+static void write_file(const char* path, const unsigned char* data, size_t size)
+{
+    FILE* f = fopen(path, "wb");
+    assert(f != NULL && fwrite(data, 1, size, f) == size);
+    fclose(f);
+}
+
+static bool same_string(const char* a, const char* b)
+{
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+// A table reopened from its cache file answers like the table it was saved
+// from, and saves back to the same bytes
+static void test_cache_file(void)
+{
+    char path[] = "/tmp/test_cache_XXXXXX";
+    char copy[] = "/tmp/test_cache_copy_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    fd = mkstemp(copy);
+    assert(fd >= 0);
+    close(fd);
+
+    for (int line_index = 0; line_index < 2; line_index++) {
+        symbol_table_t* table = symbols_create();
+        assert(table != NULL);
+        assert(symbols_set_line_index(table, line_index != 0));
+        fill_line_table(table);
+        for (int i = 0; i < 200; i++) {
+            char name[32];
+            snprintf(name, sizeof(name), "%s%d", i % 3 ? "fn_" : "Var_", i % 150);
+            assert(symbols_add_entry(table, "lib/math.c", name, i, (uint16_t)(0100 + i * 13),
+                                     i % 3 ? SYMBOL_TYPE_FUNCTION : SYMBOL_TYPE_VARIABLE));
+        }
+
+        // Saving does not freeze the caller's table behind its back
+        size_t unfrozen_count = table->count;
+        assert(!symbols_save_cache(table, path));
+        assert(!symbols_is_frozen(table) && table->count == unfrozen_count);
+        assert(symbols_freeze(table));
+        assert(symbols_save_cache(table, path));
+        symbol_table_t* cached = symbols_open_cache(path);
+        assert(cached != NULL && symbols_is_frozen(cached) && cached->count == table->count);
+        for (size_t i = 0; i < table->count; i++) {
+            const symbol_entry_t* a = &table->entries[i];
+            const symbol_entry_t* b = &cached->entries[i];
+            assert(same_string(a->filename, b->filename) && same_string(a->name, b->name));
+            assert(a->line == b->line && a->address == b->address && a->type == b->type);
+        }
+
+        const unsigned mask = SYMBOL_TYPE_MASK(SYMBOL_TYPE_FUNCTION) | SYMBOL_TYPE_MASK(SYMBOL_TYPE_VARIABLE);
+        for (uint32_t a = 0; a < 0x10000; a++) {
+            const symbol_entry_t* e = symbols_lookup_by_address(table, (uint16_t)a);
+            const symbol_entry_t* c = symbols_lookup_by_address(cached, (uint16_t)a);
+            assert((e ? e - table->entries : -1) == (c ? c - cached->entries : -1));
+            e = symbols_lookup_floor(table, (uint16_t)a, mask);
+            c = symbols_lookup_floor(cached, (uint16_t)a, mask);
+            assert((e ? e - table->entries : -1) == (c ? c - cached->entries : -1));
+            assert(same_string(symbols_get_file(table, (uint16_t)a), symbols_get_file(cached, (uint16_t)a)));
+            assert(symbols_get_line(table, (uint16_t)a) == symbols_get_line(cached, (uint16_t)a));
+            assert(symbols_get_next_line_address(table, (uint16_t)a) ==
+                   symbols_get_next_line_address(cached, (uint16_t)a));
+        }
+
+        for (size_t i = 0; i < table->count; i++) {
+            const char* name = table->entries[i].name;
+            if (!name)
+                continue;
+            const symbol_entry_t* c = symbols_lookup_by_name(cached, name);
+            assert(c && c - cached->entries == symbols_lookup_by_name(table, name) - table->entries);
+            const symbol_entry_t* next = symbols_lookup_next_by_name(cached, c);
+            const symbol_entry_t* expected = symbols_lookup_next_by_name(table, &table->entries[c - cached->entries]);
+            assert((next ? next - cached->entries : -1) == (expected ? expected - table->entries : -1));
+        }
+        assert(symbols_lookup_by_name(cached, "missing") == NULL);
+
+        const char* names[8];
+        const char* cached_names[8];
+        assert(symbols_complete_name(table, "fn_1", names, 8) == 8);
+        assert(symbols_complete_name(cached, "fn_1", cached_names, 8) == 8);
+        for (int i = 0; i < 8; i++)
+            assert(strcmp(names[i], cached_names[i]) == 0);
+
+        search_result_t result, cached_result;
+        assert(run_search(table, "var_1", SYMBOL_SEARCH_IGNORE_CASE, &result) > 0);
+        assert(run_search(cached, "var_1", SYMBOL_SEARCH_IGNORE_CASE, &cached_result) == result.count);
+        for (size_t i = 0; i < result.count; i++)
+            assert(strcmp(result.names[i], cached_result.names[i]) == 0 && result.matches[i] == cached_result.matches[i]);
+
+        uint16_t address = 0, diff = 0, cached_address = 0, cached_diff = 0;
+        assert(symbols_find_address(table, "math.c", &address, &diff, 21) ==
+               symbols_find_address(cached, "math.c", &cached_address, &cached_diff, 21));
+        assert(address == cached_address && diff == cached_diff);
+        assert(symbols_get_source_files(cached, NULL, 0) == symbols_get_source_files(table, NULL, 0));
+
+        symbol_memory_stats_t stats;
+        symbols_get_memory_stats(cached, &stats);
+        assert(stats.mapped_bytes > 0 && stats.total_bytes == memory_stats_sum(&stats));
+        assert(!symbols_add_entry(cached, "x.c", "x", 0, 0, SYMBOL_TYPE_FUNCTION));
+
+        size_t size, copy_size;
+        assert(symbols_save_cache(cached, copy));
+        unsigned char* data = read_file(path, &size);
+        unsigned char* copy_data = read_file(copy, &copy_size);
+        assert(size == copy_size && memcmp(data, copy_data, size) == 0);
+        free(copy_data);
+
+        // Damaged or foreign files are rejected
+        if (line_index) {
+            // So is damage anywhere in a section body, including to
+            // values that are not positions, like a single address
+            unsigned char* damaged = malloc(size);
+            assert(damaged != NULL);
+            uint32_t seed = 12345;
+            for (size_t at = 1024; at + 4096 <= size; at += size / 16) {
+                memcpy(damaged, data, size);
+                for (size_t i = at; i < at + 4096; i++) {
+                    seed = seed * 1103515245u + 12345u;
+                    damaged[i] = (unsigned char)(seed >> 16);
+                }
+                write_file(copy, damaged, size);
+                assert(symbols_open_cache(copy) == NULL);
+                memcpy(damaged, data, size);
+                damaged[at] ^= 0x40;
+                write_file(copy, damaged, size);
+                assert(symbols_open_cache(copy) == NULL);
+            }
+            free(damaged);
+
+            write_file(copy, data, size / 2);
+            assert(symbols_open_cache(copy) == NULL);
+            data[8] ^= 1; // Version
+            write_file(copy, data, size);
+            assert(symbols_open_cache(copy) == NULL);
+        }
+        free(data);
+
+        symbols_free(cached);
+        symbols_free(table);
+    }
+
+    unlink(path);
+    unlink(copy);
+    assert(symbols_open_cache(path) == NULL);
+    printf("cache file: ok\n");
+}
+
+static void write_map(const char* path, int lines, int first_line)
+{
+    FILE* f = fopen(path, "w");
+    assert(f != NULL);
+    for (int i = 0; i < lines; i++)
+        fprintf(f, "m.c:%d -> %06o\n", first_line + i, 01000 + 2 * i);
+    fclose(f);
+}
+
+// Load through the cache; returns the number of files the loaders read
+// (the inputs on a miss, the cache file on a hit)
+static size_t load_cached(symbol_table_t** table, const char* const* paths, size_t count,
+                          const char* dir, unsigned flags)
+{
+    symbol_load_profile_t* profile = symbols_load_profile_create();
+    assert(profile != NULL);
+    symbols_load_profile_attach(profile);
+    *table = symbols_create();
+    assert(*table != NULL);
+    assert(symbols_load_cached(*table, paths, count, dir, flags));
+    assert(symbols_is_frozen(*table));
+    symbols_load_profile_attach(NULL);
+
+    symbol_load_stats_t stats;
+    symbols_load_profile_get_stats(profile, &stats);
+    symbols_load_profile_free(profile);
+    return stats.files_loaded;
+}
+
+// Unchanged inputs reuse the cache; a changed size, time or (with
+// SYMBOL_CACHE_HASH_CONTENTS) content loads the inputs again
+static void test_load_cached(void)
+{
+    char dir[] = "/tmp/test_cache_dir_XXXXXX";
+    assert(mkdtemp(dir) != NULL);
+    char a[64], b[64];
+    snprintf(a, sizeof(a), "%s/a.map", dir);
+    snprintf(b, sizeof(b), "%s/b.srcmap", dir);
+    write_map(a, 20, 1);
+    write_map(b, 10, 100);
+    const char* paths[] = { a, b };
+
+    symbol_table_t* table;
+    assert(load_cached(&table, paths, 2, dir, 0) == 2);
+    size_t count = table->count;
+    assert(symbols_get_line(table, 01002) == 101);
+    symbols_free(table);
+
+    assert(load_cached(&table, paths, 2, dir, 0) == 1);
+    assert(table->count == count && symbols_get_line(table, 01002) == 101);
+    symbols_free(table);
+
+    // A damaged cache file costs a parse, and is replaced
+    DIR* d = opendir(dir);
+    assert(d != NULL);
+    char cache[512] = "";
+    for (struct dirent* e; (e = readdir(d)) != NULL;) {
+        if (strstr(e->d_name, ".symcache"))
+            snprintf(cache, sizeof(cache), "%s/%s", dir, e->d_name);
+    }
+    closedir(d);
+    size_t size;
+    unsigned char* data = read_file(cache, &size);
+    data[size / 2] ^= 1;
+    write_file(cache, data, size);
+    free(data);
+    assert(load_cached(&table, paths, 2, dir, 0) == 2);
+    assert(table->count == count && symbols_get_line(table, 01002) == 101);
+    symbols_free(table);
+    assert(load_cached(&table, paths, 2, dir, 0) == 1);
+    symbols_free(table);
+
+    // Another input list, another cache file
+    assert(load_cached(&table, paths, 1, dir, 0) == 1);
+    assert(table->cache == NULL && symbols_get_line(table, 01002) == 2);
+    symbols_free(table);
+    assert(load_cached(&table, paths, 1, dir, 0) == 1);
+    assert(table->cache != NULL);
+    symbols_free(table);
+
+    write_map(b, 11, 100);
+    assert(load_cached(&table, paths, 2, dir, 0) == 2);
+    assert(table->count > count);
+    symbols_free(table);
+
+    // Same size and time, different contents: only the hash notices
+    assert(load_cached(&table, paths, 2, dir, SYMBOL_CACHE_HASH_CONTENTS) == 2);
+    symbols_free(table);
+    struct stat st;
+    assert(stat(b, &st) == 0);
+    write_map(b, 11, 200);
+    struct timespec times[2] = { st.st_atim, st.st_mtim };
+    assert(utimensat(AT_FDCWD, b, times, 0) == 0);
+    assert(load_cached(&table, paths, 2, dir, 0) == 1);
+    assert(symbols_get_line(table, 01002) == 101);
+    symbols_free(table);
+    assert(load_cached(&table, paths, 2, dir, SYMBOL_CACHE_HASH_CONTENTS) == 2);
+    assert(symbols_get_line(table, 01002) == 201);
+    symbols_free(table);
+
+    // Missing inputs, unknown formats and non-empty tables are refused
+    table = symbols_create();
+    const char* missing[] = { "/nonexistent/x.map" };
+    assert(!symbols_load_cached(table, missing, 1, dir, 0));
+    const char* unknown[] = { dir };
+    assert(!symbols_load_cached(table, unknown, 1, dir, 0));
+    // A failure after some inputs loaded leaves the table empty
+    char other[64];
+    snprintf(other, sizeof(other), "%s/c.txt", dir);
+    write_map(other, 1, 1);
+    const char* partly[] = { a, other };
+    assert(!symbols_load_cached(table, partly, 2, dir, 0));
+    assert(table->count == 0 && !symbols_is_frozen(table));
+    assert(symbols_add_entry(table, "x.c", "x", 0, 0, SYMBOL_TYPE_FUNCTION));
+    assert(!symbols_load_cached(table, paths, 2, dir, 0));
+    symbols_free(table);
+
+    d = opendir(dir);
+    assert(d != NULL);
+    for (struct dirent* e; (e = readdir(d)) != NULL;) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        if (e->d_name[0] != '.')
+            assert(unlink(path) == 0);
+    }
+    closedir(d);
+    assert(rmdir(dir) == 0);
+    printf("load cached: ok\n");
+}
+
+// Debug info reopened from its binary file finds the same functions and
+// variables, with the functions in address order, and saves back to the
+// same bytes
+static void test_debug_info_file(void)
+{
+    char source[] = "/tmp/test_debug_XXXXXX";
+    char path[] = "/tmp/test_debug_bin_XXXXXX";
+    char copy[] = "/tmp/test_debug_copy_XXXXXX";
+    int fd = mkstemp(source);
+    assert(fd >= 0);
+    FILE* f = fdopen(fd, "w");
+    assert(f != NULL);
+    fprintf(f, "FUNC:helper -> 2000\nPARAM:helper:p:char* -> 4\nRBRAC:helper -> 2100\n");
+    fprintf(f, "FUNC:main -> 1000\nPARAM:main:argc:int -> 4\nPARAM:main:argv:char** -> 6\n");
+    for (int i = 0; i < 12; i++)
+        fprintf(f, "LOCAL:main:v%d:int -> %d\n", i, -2 * (i + 1));
+    fprintf(f, "FUNC:empty -> 1500\nFUNC:last -> 3000\n");
+    fclose(f);
+    fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    fd = mkstemp(copy);
+    assert(fd >= 0);
+    close(fd);
+
+    symbol_debug_info_t* info = symbols_debug_info_create();
+    assert(info != NULL);
+    assert(symbols_load_srcmap_debug(info, source));
+    assert(symbols_debug_info_save(info, path));
+
+    symbol_debug_info_t* opened = symbols_debug_info_open(path);
+    assert(opened != NULL && opened->function_count == info->function_count);
+    for (int i = 1; i < opened->function_count; i++)
+        assert(opened->functions[i - 1].start_address <= opened->functions[i].start_address);
+
+    for (uint32_t a = 0; a < 0x10000; a++) {
+        symbol_function_t* fn = symbols_find_function_at(info, (uint16_t)a);
+        symbol_function_t* ofn = symbols_find_function_at(opened, (uint16_t)a);
+        assert((fn == NULL) == (ofn == NULL));
+        if (!fn || (a & 077) != 0)
+            continue;
+        assert(strcmp(fn->name, ofn->name) == 0);
+        assert(fn->start_address == ofn->start_address && fn->end_address == ofn->end_address);
+        int count, ocount;
+        symbol_variable_t* vars = symbols_get_variables(fn, &count);
+        symbol_variable_t* ovars = symbols_get_variables(ofn, &ocount);
+        assert(count == ocount);
+        for (int v = 0; v < count; v++) {
+            assert(strcmp(vars[v].name, ovars[v].name) == 0 && strcmp(vars[v].type_name, ovars[v].type_name) == 0);
+            assert(vars[v].offset == ovars[v].offset && vars[v].is_parameter == ovars[v].is_parameter);
+        }
+    }
+    symbol_function_t* fns[4];
+    assert(symbols_complete_function(opened, "", fns, 4) == 4 && strcmp(fns[0]->name, "empty") == 0);
+
+    // Strings are stored once and used in place
+    symbol_function_t* main_fn = symbols_find_function_at(opened, 01000);
+    assert(main_fn->variables[0].type_name == main_fn->variables[2].type_name);
+    symbol_memory_stats_t stats;
+    symbols_debug_info_get_memory_stats(opened, &stats);
+    assert(stats.mapped_bytes > 0 && stats.string_bytes == 0 && stats.duplicate_strings == 0);
+    assert(stats.variable_bytes == 15 * sizeof(symbol_variable_t) && stats.variable_slack_bytes == 0);
+    assert(stats.total_bytes == memory_stats_sum(&stats));
+
+    size_t size, copy_size;
+    assert(symbols_debug_info_save(opened, copy));
+    unsigned char* data = read_file(path, &size);
+    unsigned char* copy_data = read_file(copy, &copy_size);
+    assert(size == copy_size && memcmp(data, copy_data, size) == 0);
+    free(copy_data);
+
+    // More srcmap files can still be loaded on top
+    assert(symbols_load_srcmap_debug(opened, source));
+    assert(opened->function_count == info->function_count);
+    symbols_debug_info_get_memory_stats(opened, &stats);
+    assert(stats.total_bytes == memory_stats_sum(&stats));
+
+    // Damaged or foreign files are rejected
+    write_file(copy, data, size - 8);
+    assert(symbols_debug_info_open(copy) == NULL);
+    data[8] ^= 1; // Version
+    write_file(copy, data, size);
+    assert(symbols_debug_info_open(copy) == NULL);
+    data[8] ^= 1;
+    data[40 + 8] ^= 1; // First variable of the first function, after the 40-byte header
+    write_file(copy, data, size);
+    assert(symbols_debug_info_open(copy) == NULL);
+    free(data);
+
+    symbols_debug_info_free(opened);
+    symbols_debug_info_free(info);
+    unlink(source);
+    unlink(path);
+    unlink(copy);
+    assert(symbols_debug_info_open(path) == NULL);
+    printf("debug info file: ok\n");
+}
+
+// The innermost function containing 'address', first in array order
+// among equal ranges: what symbols_find_function_at() must return
+static symbol_function_t* function_at(symbol_debug_info_t* info, uint16_t address)
+{
+    symbol_function_t* best = NULL;
+    uint16_t best_range = 0;
+    for (int i = 0; i < info->function_count; i++) {
+        symbol_function_t* fn = &info->functions[i];
+        if (address < fn->start_address || address > fn->end_address)
+            continue;
+        uint16_t range = fn->end_address == 0xFFFF ? 0xFFFE : fn->end_address - fn->start_address;
+        if (!best || range < best_range) {
+            best = fn;
+            best_range = range;
+        }
+    }
+    return best;
+}
+
+// Lookups binary search the functions by start address and walk back
+// through nested and overlapping ones
+static void test_function_lookup(void)
+{
+    symbol_debug_info_t* info = symbols_debug_info_create();
+    assert(info != NULL);
+    info->function_count = info->function_capacity = 200;
+    info->functions = calloc(200, sizeof(symbol_function_t));
+    assert(info->functions != NULL);
+    static char names[200][8];
+    uint32_t seed = 7;
+    for (int i = 0; i < 200; i++) {
+        symbol_function_t* fn = &info->functions[i];
+        snprintf(names[i], sizeof(names[i]), "f%d", i);
+        fn->name = names[i];
+        seed = seed * 1103515245u + 12345u;
+        fn->start_address = (uint16_t)(seed >> 8);
+        seed = seed * 1103515245u + 12345u;
+        uint32_t length = (seed >> 8) & (i % 10 == 0 ? 0x3FFF : 0xFF); // Some enclose others
+        fn->end_address = fn->start_address + length > 0xFFFF ? 0xFFFF : (uint16_t)(fn->start_address + length);
+        if (i % 50 == 7)
+            fn->end_address = 0xFFFF;
+    }
+    info->functions[1].start_address = info->functions[0].start_address; // Same start
+
+    // Functions filled in by hand have no index and are scanned; opened
+    // ones are indexed
+    char path[] = "/tmp/test_lookup_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    assert(symbols_debug_info_save(info, path));
+    symbol_debug_info_t* opened = symbols_debug_info_open(path);
+    assert(opened != NULL);
+    unlink(path);
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint32_t i = 0; i < 0x10000; i++) {
+            uint16_t a = pass ? (uint16_t)(i * 40503u) : (uint16_t)i;
+            assert(symbols_find_function_at(info, a) == function_at(info, a));
+            assert(symbols_find_function_at(opened, a) == function_at(opened, a));
+        }
+    }
+
+    symbols_debug_info_free(opened);
+    symbols_debug_info_free(info);
+    printf("function lookup: ok\n");
+}
+
+// Every parsed map entry owns its filename, so callers may reorder and
+// filter the array before freeing it
+static void test_mapfile_ownership(void)
+{
+    char path[] = "/tmp/test_mapfile_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    write_map(path, 20, 1);
+
+    map_entry_t* entries;
+    size_t count;
+    assert(mapfile_parse_file(path, &entries, &count) && count == 20);
+    unlink(path);
+    for (size_t i = 1; i < count; i++)
+        assert(entries[i].filename != entries[i - 1].filename && strcmp(entries[i].filename, "m.c") == 0);
+
+    // Reverse, then keep every other entry
+    for (size_t i = 0; i < count / 2; i++) {
+        map_entry_t swap = entries[i];
+        entries[i] = entries[count - 1 - i];
+        entries[count - 1 - i] = swap;
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (i % 2)
+            free((void*)entries[i].filename);
+        else
+            entries[kept++] = entries[i];
+    }
+    assert(entries[0].line == 20 && entries[1].line == 18);
+    mapfile_free_entries(entries, kept);
+    printf("mapfile ownership: ok\n");
+}
+
+// Files are registered once, in load order, and basename matches pick the
+// first FILE entry in table order
+static void test_source_files(void)
+{
+    symbol_table_t* table = symbols_create();
+    assert(table != NULL);
+    assert(symbols_get_source_files(table, NULL, 0) == 0);
+
+    assert(symbols_add_entry(table, NULL, "_start", 0, 0100, SYMBOL_TYPE_FUNCTION));
+    assert(symbols_add_entry(table, "a/x.c", NULL, 3, 0110, SYMBOL_TYPE_LINE));
+    assert(symbols_add_entry(table, "b/x.c", NULL, 0, 0, SYMBOL_TYPE_FILE));
+    assert(symbols_add_entry(table, "b/x.c", NULL, 7, 0120, SYMBOL_TYPE_LINE));
+    assert(symbols_add_entry(table, "a/x.c", NULL, 0, 0, SYMBOL_TYPE_FILE));
+    assert(symbols_add_entry(table, "", NULL, 0, 0200, SYMBOL_TYPE_FILE));
+    assert(symbols_add_entry(table, "a/x.c", NULL, 9, 0130, SYMBOL_TYPE_LINE));
+    symbols_sort_by_address(table);
+
+    const char* paths[4] = { NULL };
+    assert(symbols_get_source_files(table, paths, 1) == 2);
+    assert(strcmp(paths[0], "a/x.c") == 0 && paths[1] == NULL);
+    assert(symbols_get_source_files(table, paths, 4) == 2);
+    assert(strcmp(paths[1], "b/x.c") == 0);
+
+    uint16_t address = 0, diff = 0;
+    assert(symbols_find_address(table, "x.c", &address, &diff, 7));
+    assert(address == 0120 && diff == 0);
+    assert(symbols_find_address(table, "/elsewhere/x.c", &address, &diff, 8));
+    assert(address == 0120 && diff == 1);
+    assert(symbols_find_address(table, "a/x.c", &address, &diff, 8));
+    assert(address == 0120);
+    assert(!symbols_find_address(table, "a/y.c", &address, &diff, 8));
+
+    symbols_free(table);
+    printf("source files: ok\n");
+}
+
+int main(void) {
+    srand(1);
+
+    test_merge_semantics();
+    test_merge_random();
+    test_bulk_matches_single();
+    test_name_lookup();
+    test_line_index();
+    test_floor_and_range();
+    test_find_address();
+    test_source_files();
+    test_address_search();
+    test_freeze();
+    test_resolve_batch();
+    test_lookup_cache();
+    test_completion();
+    test_search();
+    test_memory_stats();
+    test_load_profile();
+    test_query_stats();
+    test_cache_file();
+    test_load_cached();
+    test_mapfile_ownership();
+    test_debug_info_file();
+    test_function_lookup();
+
+    printf("All symbol table tests passed\n");
+    return 0;
+}